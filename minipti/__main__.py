@@ -1,4 +1,5 @@
 import logging
+import multiprocessing
 import platform
 
 if platform.system() == "Windows":
@@ -8,6 +9,8 @@ import minipti
 
 
 def main():
+    # A frozen executable (PyInstaller) is also started as the worker process of process jobs.
+    multiprocessing.freeze_support()
     if platform.system() == "Windows":
         appid = u"FHNW.MiniPTI.1.9.5"
         ctypes.windll.shell32.SetCurrentProcessExplicitAppUserModelID(appid)
@@ -1,4 +1,8 @@
+from . import backend
+from . import kernels
+from . import swmr
 from . import interferometry
+from . import control
 from . import _utilities
 
 try:
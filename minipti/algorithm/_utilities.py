@@ -1,4 +1,7 @@
 import json
+import logging
+import threading
+from collections.abc import Iterable
 from typing import TypeVar, Type
 
 import dacite
@@ -13,3 +16,56 @@ def load_configuration(type_name: Type[T], scope: str, key: str) -> T:
     with open(f"{minipti.MODULE_PATH}/algorithm/configs/algorithm.json") as config:
         loaded_configuration = json.load(config)["Algorithm"]
         return dacite.from_dict(type_name, loaded_configuration[scope][key])
+
+
+class RowBuffer:
+    """
+    Appends rows to CSV files in the format of DataFrame.to_csv(mode="a", header=False), but without
+    creating a DataFrame for every row of the live calculation. With batch_rows > 1 the rows of a
+    file are written only every batch_rows rows, so the storage is accessed less often. Pending
+    rows are written by flush. Rows which could not be written (e.g. the file is opened by another
+    program) stay pending and are written together with the next batch of their file or by flush.
+    """
+    def __init__(self, batch_rows: int = 1):
+        self._lock = threading.Lock()
+        self._batch_rows = batch_rows
+        self._rows: dict[str, list[str]] = {}
+
+    @property
+    def batch_rows(self) -> int:
+        return self._batch_rows
+
+    @batch_rows.setter
+    def batch_rows(self, batch_rows: int) -> None:
+        with self._lock:
+            self._batch_rows = batch_rows
+        if batch_rows <= 1:
+            self.flush()
+
+    def append(self, file_path: str, index: str, values: Iterable) -> None:
+        with self._lock:
+            rows = self._rows.setdefault(file_path, [])
+            rows.append(",".join([index, *map(str, values)]) + "\n")
+            if len(rows) < self._batch_rows:
+                return
+            del self._rows[file_path]
+        self._write(file_path, rows)
+
+    def flush(self) -> None:
+        with self._lock:
+            pending, self._rows = self._rows, {}
+        for file_path, rows in pending.items():
+            self._write(file_path, rows)
+
+    def _write(self, file_path: str, rows: list[str]) -> None:
+        try:
+            with open(file_path, "a") as csv_file:
+                csv_file.writelines(rows)
+        except OSError as error:
+            with self._lock:  # In front of the rows appended in the meantime
+                self._rows[file_path] = rows + self._rows.get(file_path, [])
+            logging.warning("Could not write %d rows into %s, they are kept for the next write: %s", len(rows),
+                            file_path, error)
+
+
+CSV_ROWS = RowBuffer()
@@ -0,0 +1,346 @@
+"""
+Registry for the compute kernels of the algorithms.
+
+Every kernel has a reference implementation (backend "numpy") and optionally further
+implementations, e.g. a JIT compiled one ("numba") or one which delegates to compiled
+library routines ("native"). Which implementation is used is configured per kernel in
+algorithm.json. With "auto" the fastest implementation of a startup micro-benchmark is chosen.
+Before an implementation other than the reference is used, it has to produce the same results
+as the reference on the sample input of the kernel.
+
+An implementation can also run as shadow of a kernel on the live inputs: every shadow_every-th
+call of the kernel is repeated with the shadow implementation in a separate thread and the
+differences to the production result, both durations and the CPU time of the shadow are written to
+{destination_folder}/{path_prefix}_Shadow.csv. The production result is returned unchanged. If the
+shadow falls behind, calls are dropped instead of delaying the production.
+"""
+import dataclasses
+import functools
+import logging
+import os
+import queue
+import threading
+import time
+import timeit
+from collections.abc import Callable
+from dataclasses import dataclass
+from datetime import datetime
+from typing import Any, Final
+
+import numpy as np
+import pandas as pd
+
+import minipti
+from minipti.algorithm import _utilities
+
+
+REFERENCE: Final = "numpy"
+AUTO: Final = "auto"
+
+
+@dataclass(frozen=True)
+class BackendSettings:
+    default: str = REFERENCE
+    kernels: dict[str, str] = dataclasses.field(default_factory=dict)
+    relative_tolerance: float = 1e-6
+    absolute_tolerance: float = 1e-9
+    benchmark_repetitions: int = 20
+    shadow: dict[str, str] = dataclasses.field(default_factory=dict)  # Kernel and its shadow implementation
+    shadow_every: int = 1
+    shadow_queue_size: int = 64
+
+
+class BackendError(Exception):
+    pass
+
+
+@dataclass
+class _Kernel:
+    sample: Callable[[], tuple]
+    implementations: dict[str, Callable] = dataclasses.field(default_factory=dict)
+    selected: str | None = None
+    shadow: str | None = None
+    calls: int = 0
+
+
+_KERNELS: Final[dict[str, _Kernel]] = {}
+_lock: Final = threading.Lock()
+
+try:
+    CONFIGURATION: BackendSettings = _utilities.load_configuration(BackendSettings, "compute", "backend")
+except KeyError:
+    CONFIGURATION = BackendSettings()
+
+
+def kernel(name: str, sample: Callable[[], tuple]) -> Callable[[Callable], Callable]:
+    """
+    Declares a kernel with its reference implementation.
+    Args:
+        name (str): Name of the kernel, as used in algorithm.json.
+        sample (Callable): Returns representative arguments for the equivalence check and benchmark.
+    """
+    def decorator(function: Callable) -> Callable:
+        _KERNELS[name] = _Kernel(sample, {REFERENCE: function})
+        return function
+
+    return decorator
+
+
+def register(name: str, backend: str) -> Callable[[Callable], Callable]:
+    """
+    Adds an alternative implementation to an already declared kernel.
+    """
+    def decorator(function: Callable) -> Callable:
+        _KERNELS[name].implementations[backend] = function
+        return function
+
+    return decorator
+
+
+def kernels() -> dict[str, list[str]]:
+    return {name: list(kernel_.implementations) for name, kernel_ in _KERNELS.items()}
+
+
+def selected(name: str) -> str:
+    get(name)
+    return _KERNELS[name].selected
+
+
+def get(name: str) -> Callable:
+    """
+    Returns the selected implementation of a kernel. The selection is done at the first call.
+    """
+    kernel_ = _KERNELS[name]
+    if kernel_.selected is None:
+        with _lock:
+            if kernel_.selected is None:
+                _select(name, CONFIGURATION.kernels.get(name, CONFIGURATION.default))
+                if name in CONFIGURATION.shadow:
+                    _shadow(name, CONFIGURATION.shadow[name])
+    if kernel_.shadow is None:
+        return kernel_.implementations[kernel_.selected]
+    return functools.partial(SHADOW.call, name)
+
+
+def select(name: str, backend: str) -> None:
+    with _lock:
+        _select(name, backend)
+
+
+def _select(name: str, backend: str) -> None:
+    kernel_ = _KERNELS[name]
+    if backend == AUTO:
+        timings = benchmark(name)
+        for candidate in sorted(timings, key=timings.get):
+            if is_equivalent(name, candidate):
+                backend = candidate
+                break
+    elif backend not in kernel_.implementations:
+        logging.warning("Backend %s is not available for %s, using %s", backend, name, REFERENCE)
+        backend = REFERENCE
+    elif not is_equivalent(name, backend):
+        logging.warning("Backend %s of %s differs from %s, using %s", backend, name, REFERENCE, REFERENCE)
+        backend = REFERENCE
+    kernel_.selected = backend
+    logging.debug("Using backend %s for %s", backend, name)
+
+
+def shadow(name: str, backend: str | None) -> None:
+    """
+    Runs the implementation as shadow of the kernel, None stops shadowing.
+    """
+    get(name)
+    with _lock:
+        _shadow(name, backend)
+
+
+def _shadow(name: str, backend: str | None) -> None:
+    kernel_ = _KERNELS[name]
+    if backend is not None and backend not in kernel_.implementations:
+        logging.warning("Backend %s is not available for %s, no shadow is used", backend, name)
+        backend = None
+    kernel_.shadow = backend
+    kernel_.calls = 0
+    if backend is not None:
+        logging.info("Running backend %s as shadow of %s for %s", backend, kernel_.selected, name)
+
+
+def shadows() -> dict[str, str]:
+    return {name: kernel_.shadow for name, kernel_ in _KERNELS.items() if kernel_.shadow is not None}
+
+
+def is_equivalent(name: str, backend: str) -> bool:
+    """
+    Checks if the implementation yields the same results as the reference on the sample input.
+    """
+    kernel_ = _KERNELS[name]
+    if backend == REFERENCE:
+        return True
+    arguments = kernel_.sample()
+    try:
+        expected = kernel_.implementations[REFERENCE](*arguments)
+        result = kernel_.implementations[backend](*arguments)
+        return _all_close(expected, result)
+    except Exception as error:  # Any failing implementation is just not used
+        logging.debug("Backend %s of %s failed: %s", backend, name, error)
+        return False
+
+
+def benchmark(name: str) -> dict[str, float]:
+    """
+    Measures the best time of each implementation for one call with the sample input in s.
+    """
+    kernel_ = _KERNELS[name]
+    arguments = kernel_.sample()
+    timings = {}
+    for backend, implementation in kernel_.implementations.items():
+        try:
+            implementation(*arguments)  # JIT backends compile at the first call
+            timings[backend] = min(timeit.repeat(lambda: implementation(*arguments), number=1,
+                                                 repeat=CONFIGURATION.benchmark_repetitions))
+        except Exception as error:
+            logging.debug("Backend %s of %s failed: %s", backend, name, error)
+    logging.info("Benchmark of %s: %s", name, timings)
+    return timings
+
+
+def _all_close(expected: Any, result: Any) -> bool:
+    if isinstance(expected, tuple):
+        return len(expected) == len(result) and all(_all_close(e, r) for e, r in zip(expected, result))
+    return np.allclose(expected, result, rtol=CONFIGURATION.relative_tolerance,
+                       atol=CONFIGURATION.absolute_tolerance, equal_nan=True)
+
+
+def _copy(value: Any) -> Any:
+    if isinstance(value, tuple):
+        return tuple(_copy(element) for element in value)
+    return value.copy() if isinstance(value, np.ndarray) else value
+
+
+def _flatten(value: Any) -> np.ndarray:
+    if isinstance(value, tuple):
+        return np.concatenate([_flatten(element) for element in value])
+    return np.ravel(np.asarray(value, dtype=float))
+
+
+@dataclass(frozen=True)
+class _Call:
+    name: str
+    backend: str
+    arguments: tuple
+    result: Any
+    duration: float  # s
+    date: datetime
+
+
+class Shadow:
+    HEADER: Final = ["Time", "Kernel", "Production", "Shadow", "Production Time [ms]", "Shadow Time [ms]",
+                     "Shadow CPU Time [ms]", "Max Absolute Difference", "Max Relative Difference", "Mismatches",
+                     "Elements", "Dropped Calls", "Error"]
+
+    def __init__(self, queue_size: int = CONFIGURATION.shadow_queue_size):
+        self.destination_folder = os.getcwd()
+        self.dropped: dict[str, int] = {}  # Calls of every kernel which were not shadowed
+        self._calls: queue.Queue[_Call] = queue.Queue(maxsize=queue_size)
+        self._thread: threading.Thread | None = None
+        self._thread_lock = threading.Lock()
+        self._file_path = ""
+
+    @property
+    def file_path(self) -> str:
+        return f"{self.destination_folder}/{minipti.path_prefix}_Shadow.csv"
+
+    def call(self, name: str, *arguments) -> Any:
+        """
+        Calls the production implementation and hands the call over to the shadow.
+        """
+        kernel_ = _KERNELS[name]
+        start = time.perf_counter()
+        result = kernel_.implementations[kernel_.selected](*arguments)
+        duration = time.perf_counter() - start
+        kernel_.calls += 1
+        if kernel_.shadow is not None and not kernel_.calls % CONFIGURATION.shadow_every:
+            # The caller may reuse its buffers, so the shadow gets copies.
+            self._submit(_Call(name, kernel_.shadow, _copy(arguments), _copy(result), duration, datetime.now()))
+        return result
+
+    def _submit(self, call: _Call) -> None:
+        if self._thread is None:
+            with self._thread_lock:
+                if self._thread is None:
+                    self._thread = threading.Thread(target=self._run, name="Shadow", daemon=True)
+                    self._thread.start()
+        try:
+            self._calls.put_nowait(call)
+        except queue.Full:
+            self.dropped[call.name] = self.dropped.get(call.name, 0) + 1
+
+    def state(self) -> tuple[str, str, dict[str, str]]:
+        """
+        The destination, the path prefix and the shadowed kernels, to shadow the same in another process.
+        """
+        return self.destination_folder, minipti.path_prefix, shadows()
+
+    def restore(self, state: tuple[str, str, dict[str, str]]) -> None:
+        self.destination_folder, minipti.path_prefix, kernel_shadows = state
+        for name, kernel_ in _KERNELS.items():
+            if kernel_.shadow != kernel_shadows.get(name):
+                shadow(name, kernel_shadows.get(name))
+
+    def join(self) -> None:
+        """
+        Waits until all handed over calls are compared.
+        """
+        self._calls.join()
+
+    def _run(self) -> None:
+        while True:
+            call = self._calls.get()
+            try:
+                self._compare(call)
+            finally:
+                self._calls.task_done()
+
+    def _compare(self, call: _Call) -> None:
+        kernel_ = _KERNELS[call.name]
+        cpu_start = time.thread_time()
+        start = time.perf_counter()
+        try:
+            result = kernel_.implementations[call.backend](*call.arguments)
+            error = ""
+        except Exception as exception:  # A failing shadow must not stop the production
+            result = None
+            error = repr(exception).replace(",", ";")
+        duration = time.perf_counter() - start
+        cpu_time = time.thread_time() - cpu_start
+        expected = _flatten(call.result)
+        if result is None:
+            differences = [np.nan, np.nan, expected.size]
+        else:
+            actual = _flatten(result)
+            if actual.shape != expected.shape:
+                differences = [np.nan, np.nan, expected.size]
+                error = f"Shape {actual.shape} instead of {expected.shape}"
+            else:
+                absolute = np.abs(actual - expected)
+                relative = absolute / np.maximum(np.abs(expected), np.finfo(float).tiny)
+                mismatches = ~np.isclose(actual, expected, rtol=CONFIGURATION.relative_tolerance,
+                                         atol=CONFIGURATION.absolute_tolerance, equal_nan=True)
+                differences = [np.nanmax(absolute, initial=0), np.nanmax(relative, initial=0),
+                               np.count_nonzero(mismatches)]
+        self._write(call, [call.date.strftime("%H:%M:%S.%f"), call.name, kernel_.selected, call.backend,
+                           call.duration * 1e3, duration * 1e3, cpu_time * 1e3, *differences, expected.size,
+                           self.dropped.get(call.name, 0), error])
+
+    def _write(self, call: _Call, row: list) -> None:
+        file_path = self.file_path
+        try:
+            if file_path != self._file_path and not os.path.exists(file_path):
+                pd.DataFrame(columns=["Date", *Shadow.HEADER]).to_csv(file_path, index=False)
+            self._file_path = file_path
+            _utilities.CSV_ROWS.append(file_path, call.date.strftime("%Y-%m-%d"), row)
+        except OSError as error:
+            logging.warning("Could not write the shadow of %s: %s", call.name, error)
+
+
+SHADOW: Final = Shadow()
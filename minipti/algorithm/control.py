@@ -0,0 +1,146 @@
+"""
+Closed loop control of the interferometric working point.
+"""
+from dataclasses import dataclass, field
+from typing import Final
+
+import numpy as np
+
+from minipti.algorithm import _utilities
+from minipti.algorithm.interferometry import CharacteristicParameter, estimate_phase, phase_pseudo_inverse
+
+
+@dataclass(frozen=True)
+class OutputLimits:
+    minimum: float
+    maximum: float
+
+
+def _default_limits() -> dict[str, OutputLimits]:
+    return {"probe_laser": OutputLimits(0, 255),  # Current bits
+            "tec": OutputLimits(15, 35)}  # Setpoint temperature in °C
+
+
+@dataclass(frozen=True)
+class WorkingPointSettings:
+    use: bool = False
+    actuator: str = "probe_laser"  # "probe_laser" (current bits) or "tec" (setpoint temperature)
+    proportional_gain: float = 5  # Actuator units per rad
+    integral_gain: float = 1  # Actuator units per rad s
+    limits: dict[str, OutputLimits] = field(default_factory=_default_limits)  # Per actuator
+    max_rate: float = 10  # Actuator units per s
+    deadband: float = 0.01  # rad
+
+    @property
+    def output_limits(self) -> OutputLimits:
+        return self.limits[self.actuator]
+
+
+class PhaseEstimator:
+    """
+    Closed form estimation of the interferometric phase of one sample of every detector.
+
+    It is estimate_phase with the pseudo inverse of the output phases computed once. Compared
+    to Interferometer.calculate_phase it is less robust against noise, but needs no iterations.
+    """
+    def __init__(self, parameter: CharacteristicParameter):
+        self.parameter = parameter
+        self._pseudo_inverse = phase_pseudo_inverse(parameter.output_phases)
+
+    def __call__(self, intensities: np.ndarray) -> float | np.ndarray:
+        return estimate_phase(self.parameter, np.asarray(intensities), self._pseudo_inverse)
+
+
+def total_sensitivity(phase: float | np.ndarray, parameter: CharacteristicParameter) -> float | np.ndarray:
+    phase = np.asarray(phase)[..., np.newaxis]
+    return np.sum(parameter.amplitudes * np.abs(np.sin(phase - parameter.output_phases)), axis=-1)
+
+
+def optimal_phase(parameter: CharacteristicParameter, resolution: int = 3600) -> float:
+    """
+    The phase of maximal total sensitivity in [0, pi). Due to |sin| it repeats with a period of pi.
+    """
+    phases = np.linspace(0, np.pi, resolution, endpoint=False)
+    return phases[np.argmax(total_sensitivity(phases, parameter))]
+
+
+class WorkingPointController:
+    """
+    PI controller which holds the interferometer at the phase of maximal total sensitivity.
+
+    The output is the absolute actuator value. It is clamped to the limits of the actuator and changes
+    at most by max_rate per second. The integral only accumulates while neither limit is active
+    (conditional integration), so it does not wind up during saturation. The sign of the gains has
+    to match the sign of the phase shift per actuator unit.
+    """
+    _HALF_PERIOD: Final = np.pi
+
+    def __init__(self, parameter: CharacteristicParameter, output: float,
+                 settings: WorkingPointSettings | None = None):
+        if settings is None:
+            settings = _load_settings()
+        self.settings = settings
+        self.output = output
+        self._bias = output
+        self.integral = 0.
+        self.error = 0.
+        self.saturated = False
+        self.estimator = PhaseEstimator(parameter)
+        self.target_phase = optimal_phase(parameter)
+
+    def __repr__(self) -> str:
+        class_name = self.__class__.__name__
+        return f"{class_name}(target_phase={self.target_phase}, output={self.output}, integral={self.integral}," \
+               f" saturated={self.saturated})"
+
+    def update_parameters(self, parameter: CharacteristicParameter) -> None:
+        self.estimator = PhaseEstimator(parameter)
+        self.target_phase = optimal_phase(parameter)
+
+    def reset(self, output: float) -> None:
+        self.output = output
+        self._bias = output
+        self.integral = 0.
+
+    def phase_error(self, phase: float) -> float:
+        # The sensitivity has a period of pi, so the nearest optimum is at most pi / 2 away.
+        half_period = WorkingPointController._HALF_PERIOD
+        return (self.target_phase - phase + half_period / 2) % half_period - half_period / 2
+
+    def update(self, phase: float, period: float) -> float:
+        """
+        Calculates the next actuator value.
+        Args:
+            phase (float): The current interferometric phase in rad.
+            period (float): Time since the last update in s.
+        """
+        self.error = self.phase_error(phase)
+        if abs(self.error) < self.settings.deadband:
+            self.error = 0.
+        integral = self.integral + self.settings.integral_gain * self.error * period
+        unlimited = self._bias + self.settings.proportional_gain * self.error + integral
+        max_step = self.settings.max_rate * period
+        limited = np.clip(unlimited, self.output - max_step, self.output + max_step)
+        limits = self.settings.output_limits
+        limited = float(np.clip(limited, limits.minimum, limits.maximum))
+        self.saturated = limited != unlimited
+        if not self.saturated:
+            self.integral = integral
+        self.output = limited
+        return self.output
+
+    def step(self, intensities: np.ndarray, period: float) -> float:
+        """
+        Fast path from one DC sample of every detector to the next actuator value.
+        """
+        return self.update(float(self.estimator(intensities)), period)
+
+
+def _load_settings() -> WorkingPointSettings:
+    try:
+        return _utilities.load_configuration(WorkingPointSettings, "control", "working_point")
+    except KeyError:
+        return WorkingPointSettings()
+
+
+CONFIGURATION: Final[WorkingPointSettings] = _load_settings()
@@ -2,11 +2,14 @@
 API for characterisation and phases of an interferometer.
 """
 import collections
+import dataclasses
 import logging
+import multiprocessing
 import os
 import threading
 import typing
 from collections.abc import Generator
+from multiprocessing import connection, shared_memory
 from dataclasses import dataclass
 from datetime import datetime
 from typing import Final
@@ -18,14 +21,7 @@ from tqdm import trange
 import cvxpy as cp
 
 import minipti
-from minipti.algorithm import _utilities
-
-
-class _Locks(typing.NamedTuple):
-    output_phases: threading.Lock = threading.Lock()
-    amplitudes: threading.Lock = threading.Lock()
-    offsets: threading.Lock = threading.Lock()
-    characteristic_parameter: threading.Lock = threading.Lock()
+from minipti.algorithm import _utilities, backend, swmr
 
 
 @dataclass
@@ -36,6 +32,10 @@ class Symmetry:
 
 @dataclass
 class CharacteristicParameter:
+    """
+    Once handed to an interferometer, a parameter is not changed anymore. Updates replace it as a
+    whole, so a reader always sees amplitudes, offsets and output phases of the same update.
+    """
     amplitudes: np.ndarray[float]
     offsets: np.ndarray[float]
     output_phases: np.ndarray[float]
@@ -82,22 +82,24 @@ class Interferometer:
                                                                                          2 * np.pi / 3,
                                                                                          4 * np.pi / 3]))
         self.symmetry = Symmetry()
-        self._locks = _Locks()
+        self._lock = threading.Lock()
         self.sensitivity: np.ndarray = np.empty(shape=interferometer_dimension)
         self.destination_folder: str = os.getcwd()
         self.init_online: bool = True
         self.intensities: np.ndarray | None = None
         self.dimension = interferometer_dimension
-        self.output_data_frame = pd.DataFrame()
+        self.live_file: swmr.LiveFile | None = None
 
     def load_settings(self) -> None:
         """
         Read the characteristic values (amplitude, offset and output phase).
         """
         settings = pd.read_csv(self.settings_path, index_col="Setting")
-        self.output_phases = np.deg2rad(settings.loc["Output Phases [deg]"].to_numpy())
-        self.amplitudes = settings.loc["Amplitude [V]"].to_numpy()
-        self.offsets = settings.loc["Offset [V]"].to_numpy()
+        self.characteristic_parameter = CharacteristicParameter(
+            amplitudes=settings.loc["Amplitude [V]"].to_numpy(),
+            offsets=settings.loc["Offset [V]"].to_numpy(),
+            output_phases=np.deg2rad(settings.loc["Output Phases [deg]"].to_numpy())
+        )
 
     def __eq__(self, other) -> bool:
         return self.amplitudes == other.amplitudes and self.offsets == other.amplitudes and \
@@ -128,46 +130,54 @@ class Interferometer:
 
     @property
     def characteristic_parameter(self) -> CharacteristicParameter:
-        with self._locks.characteristic_parameter:
-            return self._characteristic_parameter
+        """
+        Readers which need more than one of the parameters take them from one snapshot of this.
+        """
+        return self._characteristic_parameter
 
     @characteristic_parameter.setter
     def characteristic_parameter(self, new_parameter: CharacteristicParameter) -> None:
-        with self._locks.characteristic_parameter:
+        with self._lock:
             self._characteristic_parameter = new_parameter
 
+    def _replace_parameter(self, **changes: np.ndarray) -> None:
+        # Copy on write, a concurrent reader keeps its consistent snapshot.
+        with self._lock:
+            self._characteristic_parameter = dataclasses.replace(self._characteristic_parameter, **changes)
+
+    def copy(self) -> "Interferometer":
+        """
+        An independent interferometer with the same settings and parameters, e.g. as workspace of
+        another thread.
+        """
+        interferometer = Interferometer(self.settings_path, self.dimension, self.decimation_filepath)
+        interferometer.characteristic_parameter = self.characteristic_parameter
+        interferometer.destination_folder = self.destination_folder
+        return interferometer
+
     @property
     def amplitudes(self) -> np.ndarray:
-        with self._locks.amplitudes:
-            amplitudes = self._characteristic_parameter.amplitudes
-        return amplitudes
+        return self._characteristic_parameter.amplitudes
 
     @amplitudes.setter
     def amplitudes(self, amplitudes: np.ndarray):
-        with self._locks.amplitudes:
-            self._characteristic_parameter.amplitudes = amplitudes
+        self._replace_parameter(amplitudes=amplitudes)
 
     @property
     def offsets(self) -> np.ndarray:
-        with self._locks.offsets:
-            offsets = self._characteristic_parameter.offsets
-        return offsets
+        return self._characteristic_parameter.offsets
 
     @offsets.setter
     def offsets(self, offsets: np.ndarray):
-        with self._locks.offsets:
-            self._characteristic_parameter.offsets = offsets
+        self._replace_parameter(offsets=offsets)
 
     @property
     def output_phases(self) -> np.ndarray:
-        with self._locks.output_phases:
-            output_phase = self._characteristic_parameter.output_phases
-        return output_phase
+        return self._characteristic_parameter.output_phases
 
     @output_phases.setter
     def output_phases(self, output_phases: np.ndarray):
-        with self._locks.output_phases:
-            self._characteristic_parameter.output_phases = output_phases
+        self._replace_parameter(output_phases=output_phases)
 
     def calculate_amplitudes(self, intensity: np.ndarray | None = None):
         """
@@ -193,41 +203,45 @@ class Interferometer:
         else:
             self.offsets = (np.max(intensity, axis=0) - np.min(intensity, axis=0)) / 2
 
-    def _error_function(self, intensity: np.ndarray) -> typing.Callable:
-        intensity_scaled = (intensity - self.offsets) / self.amplitudes
+    @staticmethod
+    def _error_function(intensity: np.ndarray, parameter: CharacteristicParameter) -> typing.Callable:
+        intensity_scaled = (intensity - parameter.offsets) / parameter.amplitudes
 
         def error(phase: np.ndarray):
             try:
-                return np.cos(phase - self.output_phases) - intensity_scaled
+                return np.cos(phase - parameter.output_phases) - intensity_scaled
             except TypeError:
-                return np.cos(np.array(phase) - np.array(self.output_phases)) - intensity_scaled
+                return np.cos(np.array(phase) - np.array(parameter.output_phases)) - intensity_scaled
 
         return error
 
-    def _error_function_df(self, phase: np.ndarray) -> np.ndarray:
-        try:
-            return -np.sin(phase - self.output_phases).reshape((self.dimension, 1))
-        except AttributeError:
-            return -np.sin(np.array(phase) - np.array(self.output_phases)).reshape((self.dimension, 1))
+    def _error_function_df(self, parameter: CharacteristicParameter) -> typing.Callable:
+        def error_df(phase: np.ndarray) -> np.ndarray:
+            try:
+                return -np.sin(phase - parameter.output_phases).reshape((self.dimension, 1))
+            except AttributeError:
+                return -np.sin(np.array(phase) - np.array(parameter.output_phases)).reshape((self.dimension, 1))
+
+        return error_df
 
     @staticmethod
     def _error(phase: float, parameters: CharacteristicParameter,
                intensities: np.ndarray) -> float:
-        return np.sum(np.abs(parameters.amplitudes * np.cos(phase - parameters.output_phases)
-                             + parameters.offsets - intensities)
-                      )
+        return backend.get("phase_error")(float(np.ravel(phase)[0]), parameters.amplitudes,
+                                          parameters.output_phases, parameters.offsets, intensities)
 
     def _calculate_phase(self, intensity: np.ndarray, guess=False) -> np.ndarray:
-        x0 = optimize.brute(func=Interferometer._error, args=(self.characteristic_parameter, intensity),
+        parameter = self.characteristic_parameter
+        x0 = optimize.brute(func=Interferometer._error, args=(parameter, intensity),
                             ranges=(slice(0, 2 * np.pi, 0.1),))[0]
         if guess:
             res = np.array([x0])
         else:
             res = optimize.least_squares(
-                fun=self._error_function(intensity),
+                fun=Interferometer._error_function(intensity, parameter),
                 x0=x0,
                 loss="soft_l1",
-                jac=self._error_function_df,
+                jac=self._error_function_df(parameter),
                 tr_solver="exact",
             ).x
         return res % (2 * np.pi)
@@ -276,19 +290,38 @@ class Interferometer:
         if self.intensities.size // self.dimension == 1:  # Only one Sample of 3 Values
             self.phase = self._calculate_phase(self.intensities)[0]
         else:
-            phase = []
-            for i in range(self.intensities.size // self.dimension):
-                phase.append(self._calculate_phase(self.intensities[i])[0])
-            self.phase = np.array(phase)
+            for _ in self.iterate_phase():
+                pass
+
+    def iterate_phase(self) -> Generator[float, None, None]:
+        """
+        Calculates the interferometric phase sample by sample.
+
+        Yields:
+            The fraction of samples of which the phase is already calculated.
+        """
+        samples = self.intensities.size // self.dimension
+        phase = np.empty(samples)
+        for i in range(samples):
+            phase[i] = self._calculate_phase(self.intensities[i])[0]
+            yield (i + 1) / samples
+        self.phase = phase
 
     def calculate_sensitivity(self) -> None:
-        try:
-            self.sensitivity = np.empty(shape=(self.dimension, len(self.phase)))
-        except TypeError:
-            self.sensitivity = [0, 0, 0]
+        parameter = self.characteristic_parameter
+        if np.ndim(self.phase) == 0:
+            # The live calculation reuses the sensitivity array of the previous sample.
+            if np.shape(self.sensitivity) != (self.dimension,):
+                self.sensitivity = np.empty(shape=self.dimension)
+            np.subtract(self.phase, parameter.output_phases, out=self.sensitivity)
+            np.sin(self.sensitivity, out=self.sensitivity)
+            np.abs(self.sensitivity, out=self.sensitivity)
+            np.multiply(parameter.amplitudes, self.sensitivity, out=self.sensitivity)
+            return
+        self.sensitivity = np.empty(shape=(self.dimension, len(self.phase)))
         for channel in range(self.dimension):
-            amplitude = self.amplitudes[channel]
-            output_phase = self.output_phases[channel]
+            amplitude = parameter.amplitudes[channel]
+            output_phase = parameter.output_phases[channel]
             self.sensitivity[channel] = amplitude * np.abs(np.sin(self.phase - output_phase))
 
     def _prepare_data(self) -> tuple[dict[str, str], dict[str, np.ndarray | float]]:
@@ -311,7 +344,6 @@ class Interferometer:
                 f"{self.destination_folder}/{minipti.path_prefix}_Interferometer.csv",
                 index_label="Date"
             )
-            self._init_live_data_frame()
             self.init_online = False
         self.calculate_phase()
         self.calculate_sensitivity()
@@ -331,29 +363,16 @@ class Interferometer:
         logging.info("Interferometer Data calculated.")
         logging.info("Saved results in %s", str(self.destination_folder))
 
-    def _init_live_data_frame(self) -> None:
-        output_data = {"Time": None, "Interferometric Phase": None}
-        for channel in range(3):
-            output_data[f"Sensitivity CH{channel + 1}"] = None
-        self.output_data_frame = pd.DataFrame(output_data, index=[None])
-
     def _save_live_data(self) -> None:
+        if self.live_file is not None:
+            self.live_file.append("Interferometer", **{"Interferometric Phase": self.phase,
+                                                       "Sensitivity": self.sensitivity})
         now = datetime.now()
         date = str(now.strftime("%Y-%m-%d"))
         current_time = str(now.strftime("%H:%M:%S"))
-        self.output_data_frame["Time"] = current_time
-        self.output_data_frame.index = [date]
-        self.output_data_frame["Interferometric Phase"] = self.phase
-        for channel in range(3):
-            self.output_data_frame[f"Sensitivity CH{channel + 1}"] = self.sensitivity[channel]
-        try:
-            self.output_data_frame.to_csv(
-                f"{self.destination_folder}/{minipti.path_prefix}_Interferometer.csv",
-                mode="a",
-                index_label="Date", header=False)
-        except PermissionError:
-            logging.warning("Could not write data. Missing values are: %s at %s.",
-                            str(self.output_data_frame)[1:-1], date + " " + current_time)
+        output_data = [current_time, self.phase, *self.sensitivity[:3]]
+        _utilities.CSV_ROWS.append(f"{self.destination_folder}/{minipti.path_prefix}_Interferometer.csv", date,
+                                   output_data)
 
     def _get_dc_signals(self, file_path: str) -> None:
         data = pd.read_csv(file_path, sep=None, engine="python", skiprows=[1])
@@ -366,13 +385,23 @@ class Interferometer:
         else:
             raise KeyError("Invalid key for DC values given")
 
-    def _calculate_offline(self, file_path: str) -> None:
+    def calculate_offline(self, file_path: str) -> Generator[float, None, None]:
+        """
+        Calculates the interferometric phase of the DC signals in file_path.
+
+        Yields:
+            The fraction of samples of which the phase is already calculated.
+        """
         if file_path:
             self._get_dc_signals(file_path)
-        self.calculate_phase()
+        yield from self.iterate_phase()
         self.calculate_sensitivity()
         self._save_data()
 
+    def _calculate_offline(self, file_path: str) -> None:
+        for _ in self.calculate_offline(file_path):
+            pass
+
     def run(self, live=False, file_path="") -> None:
         if live:
             self._calculate_online()
@@ -386,6 +415,160 @@ class CharacterizationSettings:
     keep_settings: bool
     number_of_steps: int
     min_difference: float
+    samples_per_step: int = 20
+    mode: str = "iterative"  # "iterative" or "ellipse"
+    refine: bool = True  # Only for "ellipse", one linear fit at the estimated phases
+    process: bool = False  # Live characterisation in a worker process instead of a thread
+
+
+class EllipseFit:
+    """
+    Closed form characterisation by direct least squares ellipse fits [1] to the Lissajous figures
+    of channel pairs.
+
+    Two channels I_i = B_i + A_i cos(phi - alpha_i) lie on the ellipse
+    a x^2 + b xy + c y^2 + d x + e y + f = 0 with its centre at (B_i, B_j), a A_i^2 = c A_j^2 = lambda,
+    b A_i A_j = -2 lambda cos(alpha_j - alpha_i) and lambda sin^2(alpha_j - alpha_i) = -F(B_i, B_j).
+    All pairs share the monomials up to second degree of the channels, so their scatter matrices are
+    sub matrices of one moment matrix, which is built in a single pass over the data. Every fit is
+    the solution of the generalised eigenvalue problem C p = mu S p with the constraint
+    4ac - b^2 = 1. The sign of an output phase is only defined relatively to the others and is
+    resolved with the pair of the two non reference channels.
+    [1]: A. Fitzgibbon, M. Pilu and R. B. Fisher, Direct least square fitting of ellipses, 1999
+    """
+    _CONSTRAINT: Final = np.array([[0, 0, 2], [0, -1, 0], [2, 0, 0]])
+
+    def __init__(self, dimension: int):
+        self.dimension = dimension
+        monomials = [(i, j) for i in range(dimension) for j in range(i, dimension)]
+        monomials += [(i,) for i in range(dimension)]
+        self._monomials = monomials
+        self._index = {monomial: k for k, monomial in enumerate(monomials)}
+        self._constraint = np.zeros((6, 6))
+        self._constraint[:3, :3] = EllipseFit._CONSTRAINT
+
+    def _moments(self, normalised: np.ndarray) -> np.ndarray:
+        design = np.empty((normalised.shape[0], len(self._monomials) + 1))
+        for k, monomial in enumerate(self._monomials):
+            design[:, k] = np.prod(normalised[:, list(monomial)], axis=1)
+        design[:, -1] = 1
+        return design.T @ design / normalised.shape[0]
+
+    def _fit_pair(self, moments: np.ndarray, i: int, j: int) -> tuple[np.ndarray, np.ndarray, float]:
+        """
+        Returns:
+            The centre, the amplitudes and the cosine of the phase difference of channel j to channel i.
+        """
+        columns = [self._index[(i, i)], self._index[(i, j)], self._index[(j, j)], self._index[(i,)],
+                   self._index[(j,)], len(self._monomials)]
+        scatter = moments[np.ix_(columns, columns)]
+        eigenvalues, eigenvectors = linalg.eigh(self._constraint, scatter)
+        a, b, c, d, e, f = eigenvectors[:, np.argmax(eigenvalues)] * np.sign(eigenvectors[0, np.argmax(eigenvalues)])
+        if 4 * a * c - b ** 2 <= 0:
+            raise CharacterizationError(f"Channels {i + 1} and {j + 1} do not describe an ellipse")
+        centre = linalg.solve(np.array([[2 * a, b], [b, 2 * c]]), -np.array([d, e]))
+        value_at_centre = a * centre[0] ** 2 + b * centre[0] * centre[1] + c * centre[1] ** 2 + d * centre[0] \
+            + e * centre[1] + f
+        scale = -value_at_centre * 4 * a * c / (4 * a * c - b ** 2)
+        amplitudes = np.sqrt(np.abs(scale / np.array([a, c])))
+        return centre, amplitudes, np.clip(-b / (2 * np.sqrt(a * c)), -1, 1)
+
+    def __call__(self, intensities: np.ndarray) -> CharacteristicParameter:
+        mean = np.mean(intensities, axis=0)
+        deviation = np.std(intensities, axis=0)
+        moments = self._moments((intensities - mean) / deviation)
+        offsets = np.empty(self.dimension)
+        amplitudes = np.empty(self.dimension)
+        output_phases = np.zeros(self.dimension)
+        reference_amplitudes = []
+        for j in range(1, self.dimension):
+            centre, pair_amplitudes, cosine = self._fit_pair(moments, 0, j)
+            offsets[j] = centre[1]
+            amplitudes[j] = pair_amplitudes[1]
+            reference_amplitudes.append(pair_amplitudes[0])
+            output_phases[j] = np.arccos(cosine)
+            if j == 1:
+                offsets[0] = centre[0]
+            else:
+                # The output phase of the second channel is positive by definition, the others follow from their
+                # pair to it.
+                cosine_to_first = self._fit_pair(moments, 1, j)[2]
+                if abs(np.cos(output_phases[j] - output_phases[1]) - cosine_to_first) \
+                        > abs(np.cos(-output_phases[j] - output_phases[1]) - cosine_to_first):
+                    output_phases[j] = -output_phases[j]
+        amplitudes[0] = np.mean(reference_amplitudes)
+        return CharacteristicParameter(amplitudes=amplitudes * deviation, offsets=offsets * deviation + mean,
+                                       output_phases=output_phases % (2 * np.pi))
+
+
+def phase_pseudo_inverse(output_phases: np.ndarray) -> np.ndarray:
+    """
+    Maps normalised intensities to cos(phi) and sin(phi). It only depends on the output phases, so it can be reused
+    as long as they do not change.
+    """
+    return linalg.pinv(np.column_stack([np.cos(output_phases), np.sin(output_phases)]))
+
+
+def estimate_phase(parameter: CharacteristicParameter, intensities: np.ndarray,
+                   pseudo_inverse: np.ndarray | None = None) -> np.ndarray:
+    """
+    Linear least squares estimation of the interferometric phase of every sample, since the normalised
+    intensities are linear in cos(phi) and sin(phi).
+    """
+    if pseudo_inverse is None:
+        pseudo_inverse = phase_pseudo_inverse(parameter.output_phases)
+    cosine, sine = pseudo_inverse @ ((intensities - parameter.offsets) / parameter.amplitudes).T
+    return np.arctan2(sine, cosine) % (2 * np.pi)
+
+
+class PhaseReservoir:
+    """
+    Bounded store of DC samples for the characterisation. The phase circle is divided into bins and
+    every bin keeps at most capacity samples, drawn uniformly from all samples of the bin by
+    reservoir sampling (algorithm R). Hence long dwell times in one phase region neither grow the
+    memory nor dominate the fit.
+    """
+    def __init__(self, bins: int, capacity: int, dimension: int, seed: int | None = None):
+        self.bins = bins
+        self.capacity = capacity
+        self._samples = np.empty((bins, capacity, dimension))
+        self._stored = np.zeros(bins, dtype=int)
+        self._seen = np.zeros(bins, dtype=int)
+        self._generator = np.random.default_rng(seed)
+
+    def __len__(self) -> int:
+        return int(np.sum(self._stored))
+
+    def __repr__(self) -> str:
+        class_name = self.__class__.__name__
+        return f"{class_name}(bins={self.bins}, capacity={self.capacity}, stored={len(self)}, " \
+               f"seen={np.sum(self._seen)})"
+
+    @property
+    def occupied_bins(self) -> int:
+        return int(np.count_nonzero(self._stored))
+
+    @property
+    def samples(self) -> np.ndarray:
+        """
+        A copy of all stored samples, ordered by their phase bin.
+        """
+        return self._samples[np.arange(self.capacity) < self._stored[:, np.newaxis]]
+
+    def add(self, phase: float, sample: np.ndarray) -> None:
+        k = int(self.bins / (2 * np.pi) * (phase % (2 * np.pi))) % self.bins
+        self._seen[k] += 1
+        if self._stored[k] < self.capacity:
+            self._samples[k, self._stored[k]] = sample
+            self._stored[k] += 1
+        else:
+            j = self._generator.integers(self._seen[k])
+            if j < self.capacity:
+                self._samples[k, j] = sample
+
+    def clear(self) -> None:
+        self._stored[:] = 0
+        self._seen[:] = 0
 
 
 class Characterization:
@@ -404,9 +587,20 @@ class Characterization:
 
     MIN_DIFFERENCE: Final = CONFIGURATION.min_difference
 
+    TRACKING_SIZE: Final = 3600  # Samples, 1 h of data with the default average period
+
+    SAMPLES_PER_STEP: Final = CONFIGURATION.samples_per_step
+
+    WAIT_TIME: Final = 1  # s
+
     def __init__(self, interferometer=Interferometer()):
-        self.interferometer = interferometer
-        self.tracking_phase = []
+        self._interferometer = interferometer
+        self._workspace = threading.local()
+        self._samples: np.ndarray | None = None
+        self._process: CharacterizationProcess | None = None
+        self.tracking_phase = collections.deque(maxlen=Characterization.TRACKING_SIZE)
+        self.reservoir = PhaseReservoir(Characterization.STEP_SIZE, Characterization.SAMPLES_PER_STEP,
+                                        interferometer.dimension)
         self.time_stamp = 0
         self.event = threading.Event()
         self.destination_folder = os.getcwd()
@@ -417,6 +611,7 @@ class Characterization:
         self._attempts = 0
         self._output_phase_uncertantity = 0
         self._occured_phase = np.zeros(Characterization.STEP_SIZE)
+        self.live_file: swmr.LiveFile | None = None
 
     def __repr__(self) -> str:
         class_name = self.__class__.__name__
@@ -425,6 +620,19 @@ class Characterization:
                          f" time_stamp={self.time_stamp}, interferometer={self.interferometer})"
         return representation
 
+    @property
+    def interferometer(self) -> Interferometer:
+        """
+        The live characterisation runs on a copy of the interferometer, which only its thread sees,
+        and publishes the parameters at once when finished. Every other thread and the offline
+        characterisation work on the interferometer itself.
+        """
+        return getattr(self._workspace, "interferometer", self._interferometer)
+
+    @interferometer.setter
+    def interferometer(self, interferometer: Interferometer) -> None:
+        self._interferometer = interferometer
+
     @property
     def progress(self) -> int:
         return self._progess
@@ -451,13 +659,48 @@ class Characterization:
         self.interferometer.symmetry.absolute = absolute_symmetry
         self.interferometer.symmetry.relative = relative_symmetry
 
-    def characterise(self, live=False, file_path="") -> None:
+    def characterise(self, live=False, file_path="") -> bool:
         """
         Characterises the interferometer either live (with data from the motherboard) or offline.
         Args:
             live (bool): Decides if running live with motherboard connected or offline with already measured data.
             file_path (str): File path to the DC data
+        Returns:
+            False if live and no samples have been handed over within the wait time or the
+            characterisation failed.
+        """
+        if live:
+            self._init_headers(f"{minipti.path_prefix}_Characterisation.csv")
+            return self._calculate_online()
+        for _ in self.characterise_offline(file_path):
+            pass
+        return True
+
+    def close(self) -> None:
         """
+        Stops the worker process of the live characterisation, if any.
+        """
+        if self._process is not None:
+            self._process.close()
+            self._process = None
+
+    def characterise_offline(self, file_path: str) -> Generator[float, None, None]:
+        """
+        Characterises the interferometer with already measured data.
+        Args:
+            file_path (str): File path to the DC data
+        Yields:
+            The fraction of already processed samples.
+        """
+        self._init_headers("Offline_Characterisation.csv")
+        try:
+            yield from self._calculate_offline(file_path)
+        except CharacterizationError:
+            logging.warning("Not enough values for characterisation")
+        finally:
+            self.init_headers = True
+
+    def _init_headers(self, dest_file_path: str) -> None:
         if self.init_headers:
             units = {}
             # The output data has no headers and relies on this order
@@ -468,50 +711,62 @@ class Characterization:
                 units[f"Offset CH{channel}"] = "V"
             units["Symmetry"] = "%"
             units["Relative Symmetry"] = "%"
-            if live:
-                dest_file_path = f"{minipti.path_prefix}_Characterisation.csv"
-            else:
-                dest_file_path = "Offline_Characterisation.csv"
             pd.DataFrame(units, index=["s"]).to_csv(
-                dest_file_path,
+                f"{self.destination_folder}/{dest_file_path}",
                 index_label="Time Stamp"
             )
             self.init_headers = False
-        if live:
-            self._calculate_online()
-        else:
-            try:
-                self._calculate_offline(file_path)
-                self.init_headers = True
-            except CharacterizationError:
-                logging.warning("Not enough values for characterisation")
 
-    def add_phase(self, phase: float) -> None:
+    def add_phase(self, phase: float, dc_signals: np.ndarray | None = None) -> None:
         """
         Adds a phase to list of occurred phase and mark its corresponding index in the occurred
         array. Note that the occured phase counter increases only if the phase is relevant.
         A phase is relevant if it lies in the first (n-1)/n of the circle.
         Args:
             phase (float): The occurred interferometric phase in rad.
+            dc_signals (np.ndarray): The DC signals at this phase, which are sampled into the reservoir.
         """
         self.time_stamp += 1
         k = int(Characterization.STEP_SIZE / (2 * np.pi) * phase)
         self.tracking_phase.append(phase)
-        self._occured_phase[k] = True 
+        self._occured_phase[k] = True
+        if dc_signals is not None:
+            self.reservoir.add(phase, dc_signals)
+
+    def take_samples(self) -> bool:
+        """
+        Hands a copy of the reservoir over to the characterisation if enough phases occurred and no
+        characterisation is running. The buffers are reset by the calling thread, which is the only
+        one adding phases.
+        Returns:
+            True if a characterisation has been started.
+        """
+        if not self.enough_values or self.event.is_set():
+            return False
+        self._samples = self.reservoir.samples
+        self._clear_samples()
+        self.event.set()
+        return True
 
     def clear(self) -> None:
         """
         Resets the characterisation buffers.
         """
-        self.tracking_phase = []
+        self._clear_samples()
         self.event.clear()
+
+    def _clear_samples(self) -> None:
+        self.tracking_phase.clear()
+        self.reservoir.clear()
         self._occured_phase = np.zeros(Characterization.STEP_SIZE)
 
     def _load_settings(self) -> None:
         settings = pd.read_csv(self.interferometer.settings_path, index_col="Setting")
-        self.interferometer.output_phases = np.deg2rad(settings.loc["Output Phases [deg]"]).to_numpy()
-        self.interferometer.amplitudes = settings.loc["Amplitude [V]"].to_numpy()
-        self.interferometer.offsets = settings.loc["Offset [V]"].to_numpy()
+        self.interferometer.characteristic_parameter = CharacteristicParameter(
+            amplitudes=settings.loc["Amplitude [V]"].to_numpy(),
+            offsets=settings.loc["Offset [V]"].to_numpy(),
+            output_phases=np.deg2rad(settings.loc["Output Phases [deg]"]).to_numpy()
+        )
         self.use_parameters = True
 
     def _estimate_settings(self, dc_signals: np.ndarray) -> None:
@@ -548,28 +803,43 @@ class Characterization:
                 raise CharacterizationError("Not enough values for characterisation")
 
     def _characterise_interferometer_2(self) -> np.ndarray:
-        def transform(linear_result) -> tuple[float, float, float]:
-            return (np.arctan2(linear_result[2], linear_result[1]) % (2 * np.pi),
-                    np.sqrt(linear_result[1] ** 2 + linear_result[2] ** 2),
-                    linear_result[0])
-        cost = []
-        cosine_values = np.cos(self.interferometer.phase)
-        sine_values = np.sin(self.interferometer.phase)
-        desing_matrix = np.array([np.ones(cosine_values.shape), cosine_values, sine_values]).T
-        for channel in range(3):
-            target = self.interferometer.intensities.T[channel]
-            from scipy import linalg
-            x, error, _, _ = linalg.lstsq(desing_matrix, target, check_finite=False)
-            output_phase, amplitude, offset = transform(x)
-            self.interferometer.output_phases[channel] = output_phase
-            self.interferometer.amplitudes[channel] = amplitude
-            self.interferometer.offsets[channel] = offset
-            cost.append(np.linalg.norm(error))
-        self.interferometer.output_phases -= self.interferometer.output_phases[0]
-        self.interferometer.output_phases %= 2 * np.pi
-        return np.mean(cost)
+        output_phases, amplitudes, offsets, cost = backend.get("characterisation_fit")(
+            np.asarray(self.interferometer.phase),
+            self.interferometer.intensities
+        )
+        self.interferometer.characteristic_parameter = CharacteristicParameter(
+            amplitudes=amplitudes,
+            offsets=offsets,
+            output_phases=(output_phases - output_phases[0]) % (2 * np.pi)
+        )
+        return cost
 
     def _characterise(self) -> None:
+        if Characterization.CONFIGURATION.mode == "ellipse":
+            try:
+                self._characterise_ellipse()
+                return
+            except (CharacterizationError, linalg.LinAlgError) as error:
+                logging.warning("Ellipse fit failed (%s), characterising iteratively", error)
+        self._characterise_iterative()
+
+    def _characterise_ellipse(self) -> None:
+        intensities = np.asarray(self.interferometer.intensities)
+        parameter = EllipseFit(self.interferometer.dimension)(intensities)
+        phase = estimate_phase(parameter, intensities)
+        if Characterization.CONFIGURATION.refine:
+            self.interferometer.characteristic_parameter = parameter
+            self.interferometer.phase = phase
+            self._output_phase_uncertantity = self._characterise_interferometer_2()
+            phase = estimate_phase(self.interferometer.characteristic_parameter, intensities)
+        else:
+            parameter.output_phases = (parameter.output_phases - parameter.output_phases[0]) % (2 * np.pi)
+            self.interferometer.characteristic_parameter = parameter
+            self._output_phase_uncertantity = 0
+        self.interferometer.phase = phase
+        logging.info("Ellipse fit:\n%s", str(self.interferometer))
+
+    def _characterise_iterative(self) -> None:
         self.interferometer.calculate_phase()
         cost = [self._characterise_interferometer_2()]
         logging.info("First guess:\n%s", str(self.interferometer))
@@ -598,7 +868,7 @@ class Characterization:
         output_data["Relative Symmetry"] = self.interferometer.symmetry.relative
         return output_data
 
-    def _calculate_offline(self, file_path: str):
+    def _calculate_offline(self, file_path: str) -> Generator[float, None, None]:
         data = pd.read_csv(file_path, sep=None, engine="python", skiprows=[1])
         for header in Interferometer.DC_HEADERS:
             try:
@@ -608,6 +878,7 @@ class Characterization:
                 continue
         else:
             raise KeyError("Invalid key for DC values given")
+        data_length: int = dc_signals.size // self.interferometer.dimension
         process_characterisation = self.process(dc_signals)
         for i in process_characterisation:
             output_data = self._add_characterised_data()
@@ -617,17 +888,39 @@ class Characterization:
                 index_label="Time Stamp",
                 header=False
             )
+            yield (i + 1) / data_length if i >= 0 else 1
         logging.info("Characterization finished")
         logging.info("Saved data into %s", self.destination_folder)
 
-    def _calculate_online(self) -> None:
-        self.event.wait()
-        self._characterise()
+    def _calculate_online(self) -> bool:
+        if not self.event.wait(timeout=Characterization.WAIT_TIME):
+            return False
+        if Characterization.CONFIGURATION.process:
+            if self._process is None:
+                self._process = CharacterizationProcess(self._interferometer.dimension,
+                                                        Characterization.STEP_SIZE * Characterization.SAMPLES_PER_STEP)
+            try:
+                parameter, self._output_phase_uncertantity = self._process.characterise(
+                    self._interferometer.characteristic_parameter, self._samples
+                )
+            except (CharacterizationError, linalg.LinAlgError, ValueError) as error:
+                logging.warning("Characterisation failed: %s", error)
+                if not self._process.alive:
+                    self.close()  # Restarted with the next samples
+                self.event.clear()
+                return False
+        else:
+            parameter = self._characterise_workspace()
+        self._interferometer.characteristic_parameter = parameter
         characterised_data = {}
         for i in range(3):
-            characterised_data[f"Output Phase CH{1 + i}"] = np.rad2deg(self.interferometer.output_phases[i])
-            characterised_data[f"Amplitude CH{1 + i}"] = self.interferometer.amplitudes[i]
-            characterised_data[f"Offset CH{1 + i}"] = self.interferometer.offsets[i]
+            characterised_data[f"Output Phase CH{1 + i}"] = np.rad2deg(parameter.output_phases[i])
+            characterised_data[f"Amplitude CH{1 + i}"] = parameter.amplitudes[i]
+            characterised_data[f"Offset CH{1 + i}"] = parameter.offsets[i]
+        if self.live_file is not None:
+            self.live_file.append("Characterisation", **{"Output Phases": parameter.output_phases,
+                                                         "Amplitudes": parameter.amplitudes,
+                                                         "Offsets": parameter.offsets})
         file_destination: str = f"{self.destination_folder}/{minipti.path_prefix}_Characterisation.csv"
         pd.DataFrame(characterised_data, index=[self.time_stamp]).to_csv(
             file_destination,
@@ -635,4 +928,106 @@ class Characterization:
             header=False,
             index_label="Time Stamp"
         )
-        self.clear()
+        self.event.clear()
+        return True
+
+    def _characterise_workspace(self) -> CharacteristicParameter:
+        workspace = self._interferometer.copy()
+        workspace.intensities = self._samples
+        self._workspace.interferometer = workspace
+        try:
+            self._characterise()
+        finally:
+            del self._workspace.interferometer
+        return workspace.characteristic_parameter
+
+
+class CharacterizationProcess:
+    """
+    Runs the live characterisation in a spawned worker process, so its iterations share neither
+    the GIL nor the CPU time of the live calculation. The DC samples are handed over through a
+    shared memory window, only the parameters are sent over the pipe. A new characterisation may
+    only be requested after the previous one has returned, since the window is not double buffered.
+    """
+    def __init__(self, dimension: int, capacity: int):
+        self._memory = shared_memory.SharedMemory(create=True, size=capacity * dimension * np.dtype(float).itemsize)
+        self._window = np.ndarray((capacity, dimension), buffer=self._memory.buf)
+        self._connection, child_connection = multiprocessing.Pipe()
+        self._worker = multiprocessing.get_context("spawn").Process(
+            target=_characterise_remote,
+            args=(child_connection, self._memory.name, self._window.shape, Characterization.CONFIGURATION),
+            name="Characterisation",
+            daemon=True
+        )
+        self._worker.start()
+        child_connection.close()
+        logging.info("Started characterisation process %d", self._worker.pid)
+
+    def characterise(self, parameter: CharacteristicParameter,
+                     samples: np.ndarray) -> tuple[CharacteristicParameter, float]:
+        """
+        Returns:
+            The characterised parameters and the uncertainty of the output phases.
+        Raises:
+            CharacterizationError, LinAlgError, ValueError: If the characterisation failed.
+        """
+        rows = min(len(samples), len(self._window))
+        self._window[:rows] = samples[:rows]
+        try:
+            self._connection.send((parameter, rows, backend.SHADOW.state()))
+            result = self._connection.recv()
+        except (EOFError, OSError) as error:
+            raise CharacterizationError(f"Characterisation process exited with {self._worker.exitcode}") from error
+        if isinstance(result, Exception):
+            raise result
+        return result
+
+    @property
+    def alive(self) -> bool:
+        return self._worker.is_alive()
+
+    def close(self) -> None:
+        try:
+            self._connection.send(None)
+        except (BrokenPipeError, OSError):
+            pass
+        self._worker.join(timeout=Characterization.WAIT_TIME)
+        if self._worker.is_alive():
+            self._worker.terminate()
+        self._connection.close()
+        del self._window
+        self._memory.close()
+        self._memory.unlink()
+
+
+def _characterise_remote(pipe: connection.Connection, memory_name: str, shape: tuple[int, int],
+                         configuration: CharacterizationSettings) -> None:
+    """
+    Entry point of the characterisation process, which serves requests until it gets None.
+    """
+    Characterization.CONFIGURATION = configuration  # Changes of the parent since its import
+    memory = shared_memory.SharedMemory(name=memory_name)
+    window = np.ndarray(shape, buffer=memory.buf)
+    try:
+        while (request := pipe.recv()) is not None:
+            parameter, rows, shadow = request
+            backend.SHADOW.restore(shadow)
+            interferometer = Interferometer(interferometer_dimension=shape[1])
+            interferometer.characteristic_parameter = parameter
+            interferometer.intensities = window[:rows].copy()
+            characterization = Characterization(interferometer)
+            try:
+                characterization._characterise()
+            except (CharacterizationError, linalg.LinAlgError, ValueError) as error:
+                pipe.send(error)
+                continue
+            finally:
+                if backend.shadows():  # The process may be terminated before the rows are written
+                    backend.SHADOW.join()
+                    _utilities.CSV_ROWS.flush()
+            pipe.send((interferometer.characteristic_parameter, characterization._output_phase_uncertantity))
+    except EOFError:  # Parent is gone
+        pass
+    finally:
+        del window
+        memory.close()
@@ -0,0 +1,250 @@
+"""
+Implementations of the compute kernels, which are dispatched by the backend registry.
+"""
+import math
+
+import numpy as np
+import pandas as pd
+from scipy import linalg
+
+from minipti.algorithm import backend
+
+try:
+    import numba
+except ModuleNotFoundError:
+    numba = None
+
+
+def _lock_in_sample() -> tuple[np.ndarray, np.ndarray, np.ndarray]:
+    generator = np.random.default_rng(0)
+    time = np.arange(8000)
+    ac = generator.normal(size=(3, time.size))
+    return ac, np.cos(2 * np.pi / 100 * time), np.sin(2 * np.pi / 100 * time)
+
+
+@backend.kernel("lock_in", sample=_lock_in_sample)
+def lock_in(ac: np.ndarray, in_phase: np.ndarray, quadrature: np.ndarray) -> tuple[np.ndarray, np.ndarray]:
+    """
+    Returns:
+        The amplitude and phase of the AC signals with respect to the reference.
+    """
+    ac_x = np.mean(ac * in_phase, axis=1)
+    ac_y = np.mean(ac * quadrature, axis=1)
+    return np.sqrt(ac_x ** 2 + ac_y ** 2), np.arctan2(ac_y, ac_x) % (2 * np.pi)
+
+
+@backend.register("lock_in", "native")
+def _lock_in_native(ac: np.ndarray, in_phase: np.ndarray,
+                    quadrature: np.ndarray) -> tuple[np.ndarray, np.ndarray]:
+    # Matrix vector products are calculated by BLAS without temporary arrays.
+    ac_x = ac @ in_phase / in_phase.size
+    ac_y = ac @ quadrature / quadrature.size
+    return np.sqrt(ac_x ** 2 + ac_y ** 2), np.arctan2(ac_y, ac_x) % (2 * np.pi)
+
+
+def _phase_error_sample() -> tuple[float, np.ndarray, np.ndarray, np.ndarray, np.ndarray]:
+    return 1., np.array([1., 0.9, 1.1]), np.array([0., 2., 4.]), np.array([1.5, 1.4, 1.6]), np.array([2., 1., 1.2])
+
+
+@backend.kernel("phase_error", sample=_phase_error_sample)
+def phase_error(phase: float, amplitudes: np.ndarray, output_phases: np.ndarray, offsets: np.ndarray,
+                intensities: np.ndarray) -> float:
+    """
+    Returns:
+        The absolute deviation of the intensities to the ones of an interferometer at phase.
+    """
+    return np.sum(np.abs(amplitudes * np.cos(phase - output_phases) + offsets - intensities))
+
+
+@backend.register("phase_error", "native")
+def _phase_error_native(phase: float, amplitudes: np.ndarray, output_phases: np.ndarray, offsets: np.ndarray,
+                        intensities: np.ndarray) -> float:
+    # For three channels the overhead of numpy ufuncs dominates over scalar math.
+    return sum(abs(amplitude * math.cos(phase - output_phase) + offset - intensity)
+               for amplitude, output_phase, offset, intensity in zip(amplitudes, output_phases, offsets,
+                                                                     intensities))
+
+
+def _characterisation_fit_sample() -> tuple[np.ndarray, np.ndarray]:
+    generator = np.random.default_rng(0)
+    phase = generator.uniform(0, 2 * np.pi, size=1000)
+    output_phases = np.array([0, 2 * np.pi / 3, 4 * np.pi / 3])
+    intensities = 1.5 + np.cos(phase[:, np.newaxis] - output_phases) + generator.normal(scale=0.01, size=(1000, 3))
+    return phase, intensities
+
+
+@backend.kernel("characterisation_fit", sample=_characterisation_fit_sample)
+def characterisation_fit(phase: np.ndarray,
+                         intensities: np.ndarray) -> tuple[np.ndarray, np.ndarray, np.ndarray, float]:
+    """
+    Fits I = B + A cos(phi - alpha) linearly for every channel at the given phases.
+    Returns:
+        The output phases, amplitudes, offsets and the mean residual of the fit.
+    """
+    cosine_values = np.cos(phase)
+    sine_values = np.sin(phase)
+    design_matrix = np.array([np.ones(cosine_values.shape), cosine_values, sine_values]).T
+    channels = intensities.shape[1]
+    output_phases = np.empty(channels)
+    amplitudes = np.empty(channels)
+    offsets = np.empty(channels)
+    cost = []
+    for channel in range(channels):
+        x, error, _, _ = linalg.lstsq(design_matrix, intensities.T[channel], check_finite=False)
+        output_phases[channel] = np.arctan2(x[2], x[1]) % (2 * np.pi)
+        amplitudes[channel] = np.sqrt(x[1] ** 2 + x[2] ** 2)
+        offsets[channel] = x[0]
+        cost.append(np.linalg.norm(error))
+    return output_phases, amplitudes, offsets, np.mean(cost)
+
+
+@backend.register("characterisation_fit", "native")
+def _characterisation_fit_native(phase: np.ndarray,
+                                 intensities: np.ndarray) -> tuple[np.ndarray, np.ndarray, np.ndarray, float]:
+    # All channels share the design matrix, so one solve of the normal equations fits all of them.
+    design_matrix = np.column_stack([np.ones(phase.shape), np.cos(phase), np.sin(phase)])
+    x = linalg.solve(design_matrix.T @ design_matrix, design_matrix.T @ intensities, assume_a="pos",
+                     check_finite=False)
+    residuals = np.sum((design_matrix @ x - intensities) ** 2, axis=0)
+    return np.arctan2(x[2], x[1]) % (2 * np.pi), np.sqrt(x[1] ** 2 + x[2] ** 2), x[0], np.mean(residuals)
+
+
+def _rolling_sample() -> tuple[np.ndarray, int]:
+    return np.random.default_rng(0).normal(size=3600), 60
+
+
+@backend.kernel("rolling", sample=_rolling_sample)
+def rolling(data: np.ndarray, window: int) -> tuple[np.ndarray, np.ndarray]:
+    """
+    Returns:
+        The centered rolling mean and median of data. Incomplete windows are NaN.
+    """
+    data = np.ravel(data)
+    mean = np.full(data.shape, np.nan)
+    median = np.full(data.shape, np.nan)
+    if data.size >= window:
+        windows = np.lib.stride_tricks.sliding_window_view(data, window)
+        start = window // 2
+        mean[start:start + len(windows)] = np.mean(windows, axis=1)
+        median[start:start + len(windows)] = np.median(windows, axis=1)
+    return mean, median
+
+
+@backend.register("rolling", "native")
+def _rolling_native(data: np.ndarray, window: int) -> tuple[np.ndarray, np.ndarray]:
+    rolling_window = pd.Series(np.ravel(data)).rolling(window, center=True)
+    return rolling_window.mean().to_numpy(), rolling_window.median().to_numpy()
+
+
+def _daq_decode_sample() -> tuple[str]:
+    words = np.random.default_rng(0).integers(0, 1 << 16, size=(128, 8), dtype=np.uint16)
+    return "".join(f"{word:04X}" for word in words.ravel()),
+
+
+@backend.kernel("daq_decode", sample=_daq_decode_sample)
+def daq_decode(raw_data: str) -> tuple[np.ndarray, np.ndarray, np.ndarray]:
+    """
+    Decodes blocks of 8 hex encoded 16 bit words: Ref, AC 1 - 3 (signed), DC 1 - 4 (unsigned).
+    Returns:
+        The reference, AC and DC signals with one row per channel.
+    """
+    words = np.frombuffer(bytes.fromhex(raw_data), dtype=">u2").reshape(-1, 8)
+    return words[:, 0], words[:, 1:4].view(">i2").T, words[:, 4:8].T
+
+
+@backend.register("daq_decode", "native")
+def _daq_decode_native(raw_data: str) -> tuple[np.ndarray, np.ndarray, np.ndarray]:
+    # Decoding byte wise avoids the reshaped big endian views.
+    data = np.frombuffer(bytes.fromhex(raw_data), dtype=np.uint8).reshape(-1, 16).astype(np.int32)
+    words = data[:, 0::2] << 8 | data[:, 1::2]
+    ac = words[:, 1:4]
+    return words[:, 0], np.where(ac >= 1 << 15, ac - (1 << 16), ac).T, words[:, 4:8].T
+
+
+def _common_mode_sample() -> tuple[np.ndarray, np.ndarray, np.ndarray, np.ndarray, float, int, float]:
+    generator = np.random.default_rng(0)
+    reference = generator.normal(size=8000)
+    ac = 0.1 * reference + generator.normal(scale=0.01, size=(3, 8000))
+    return ac, reference, np.zeros((3, 4)), np.zeros(3), 0.1, 100, 1e-12
+
+
+@backend.kernel("common_mode", sample=_common_mode_sample)
+def common_mode(ac: np.ndarray, reference: np.ndarray, weights: np.ndarray, history: np.ndarray, step_size: float,
+                block_size: int, regularisation: float) -> tuple[np.ndarray, np.ndarray, np.ndarray]:
+    """
+    Block normalised LMS canceller: every AC channel is predicted by an FIR filter of the reference,
+    the prediction is subtracted and the filter adapted once per block.
+    Args:
+        weights (np.ndarray): FIR weights of every channel (channels x taps), the newest tap last.
+        history (np.ndarray): The last taps - 1 reference samples of the previous call.
+    Returns:
+        The cleaned AC signals, the adapted weights and the history for the next call.
+    """
+    taps = weights.shape[1]
+    extended = np.concatenate([history, reference])
+    windows = np.lib.stride_tricks.sliding_window_view(extended, taps)
+    weights = weights.copy()
+    cleaned = np.empty(ac.shape)
+    for start in range(0, reference.size, block_size):
+        block = windows[start:start + block_size]
+        error = ac[:, start:start + block_size] - weights @ block.T
+        cleaned[:, start:start + block_size] = error
+        weights += step_size * (error @ block) / (regularisation + np.sum(block * block))
+    return cleaned, weights, extended[extended.size - taps + 1:]
+
+
+if numba is not None:
+    @backend.register("lock_in", "numba")
+    @numba.njit(cache=True, nogil=True)
+    def _lock_in_numba(ac: np.ndarray, in_phase: np.ndarray,
+                       quadrature: np.ndarray) -> tuple[np.ndarray, np.ndarray]:
+        channels, samples = ac.shape
+        amplitude = np.empty(channels)
+        phase = np.empty(channels)
+        for channel in range(channels):
+            ac_x = 0.
+            ac_y = 0.
+            for i in range(samples):
+                ac_x += ac[channel, i] * in_phase[i]
+                ac_y += ac[channel, i] * quadrature[i]
+            ac_x /= samples
+            ac_y /= samples
+            amplitude[channel] = math.sqrt(ac_x ** 2 + ac_y ** 2)
+            phase[channel] = math.atan2(ac_y, ac_x) % (2 * math.pi)
+        return amplitude, phase
+
+    @backend.register("phase_error", "numba")
+    @numba.njit(cache=True, nogil=True)
+    def _phase_error_numba(phase: float, amplitudes: np.ndarray, output_phases: np.ndarray, offsets: np.ndarray,
+                           intensities: np.ndarray) -> float:
+        error = 0.
+        for i in range(intensities.size):
+            error += abs(amplitudes[i] * math.cos(phase - output_phases[i]) + offsets[i] - intensities[i])
+        return error
+
+    @backend.register("common_mode", "numba")
+    @numba.njit(cache=True, nogil=True)
+    def _common_mode_numba(ac: np.ndarray, reference: np.ndarray, weights: np.ndarray, history: np.ndarray,
+                           step_size: float, block_size: int,
+                           regularisation: float) -> tuple[np.ndarray, np.ndarray, np.ndarray]:
+        channels, taps = weights.shape
+        extended = np.concatenate((history, reference))
+        weights = weights.copy()
+        cleaned = np.empty(ac.shape)
+        gradient = np.zeros(weights.shape)
+        power = regularisation
+        for i in range(reference.size):
+            for channel in range(channels):
+                prediction = 0.
+                for tap in range(taps):
+                    prediction += weights[channel, tap] * extended[i + tap]
+                cleaned[channel, i] = ac[channel, i] - prediction
+                for tap in range(taps):
+                    gradient[channel, tap] += cleaned[channel, i] * extended[i + tap]
+            for tap in range(taps):
+                power += extended[i + tap] ** 2
+            if (i + 1) % block_size == 0 or i + 1 == reference.size:
+                weights += step_size * gradient / power
+                gradient[:] = 0
+                power = regularisation
+        return cleaned, weights, extended[extended.size - taps + 1:]
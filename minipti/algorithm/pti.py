@@ -1,6 +1,7 @@
 """
 API for PTI Inversion and Decimation.
 """
+import functools
 import itertools
 import logging
 import os
@@ -15,7 +16,7 @@ import pandas as pd
 
 import minipti
 import minipti.algorithm.interferometry as interferometry
-from minipti.algorithm import _utilities
+from minipti.algorithm import _utilities, backend, swmr
 
 
 @dataclass
@@ -37,6 +38,74 @@ class DecimationSettings:
     ref_voltage: float
     dc_resolution: int
     ac_resolution: int
+    sample_rate: int = 8000  # Hz
+    ref_period: int = 100  # Samples
+
+
+@dataclass(frozen=True)
+class OfflineDecimationSettings:
+    window: float = 0  # s, 0 decimates every stored package on its own, else whole reference periods
+    hop: float = 0  # s, 0 is the window, else whole reference periods
+
+
+def _load_offline_decimation() -> OfflineDecimationSettings:
+    try:
+        return _utilities.load_configuration(OfflineDecimationSettings, "pti", "offline_decimation")
+    except KeyError:
+        return OfflineDecimationSettings()
+
+
+@dataclass(frozen=True)
+class CommonModeSettings:
+    use: bool = True  # Initial state of the reduction, the GUI toggle can change it for live calculations
+    method: str = "static"  # "static" (one factor per package) or "adaptive" (block NLMS on the raw samples)
+    taps: int = 4
+    step_size: float = 0.05
+    block_size: int = 100  # Samples, one reference period
+    regularisation: float = 1e-12
+
+
+def _load_common_mode() -> CommonModeSettings:
+    try:
+        return _utilities.load_configuration(CommonModeSettings, "pti", "common_mode")
+    except KeyError:
+        return CommonModeSettings()
+
+
+class CommonModeCanceller:
+    """
+    Streaming adaptive cancellation of the laser intensity noise in the AC channels.
+
+    The reference is the high passed sum of the raw DC channels. For an interferometer with
+    symmetric output phases it does not depend on the interferometric phase, but follows the
+    intensity of the probe laser. Every AC channel is predicted by a short FIR filter of the
+    reference, which is adapted by normalised LMS per block of samples and kept between packages.
+    """
+    def __init__(self, channels: int = 3, settings: CommonModeSettings | None = None):
+        self.settings = _load_common_mode() if settings is None else settings
+        self.weights = np.zeros((channels, self.settings.taps))
+        self._history = np.zeros(self.settings.taps - 1)
+        self.reduction = np.ones(channels)  # Power of the cleaned to the raw AC signals
+
+    def __repr__(self) -> str:
+        class_name = self.__class__.__name__
+        return f"{class_name}(weights={self.weights}, reduction={self.reduction})"
+
+    def reset(self) -> None:
+        self.weights[:] = 0
+        self._history[:] = 0
+        self.reduction[:] = 1
+
+    def __call__(self, ac: np.ndarray, dc: np.ndarray) -> np.ndarray:
+        reference = np.sum(dc, axis=0)
+        reference = reference - np.mean(reference)
+        cleaned, self.weights, self._history = backend.get("common_mode")(
+            ac, reference, self.weights, self._history, self.settings.step_size, self.settings.block_size,
+            self.settings.regularisation
+        )
+        with np.errstate(divide="ignore", invalid="ignore"):
+            self.reduction = np.sum(cleaned ** 2, axis=1) / np.sum(np.asarray(ac) ** 2, axis=1)
+        return cleaned
 
 
 class Decimation:
@@ -47,21 +116,30 @@ class Decimation:
          interferometer for aerosol measurements
     """
     REF_VOLTAGE: Final = 3.3  # V
-    SAMPLE_PERIOD: Final = 8e3
-    REF_PERIOD: Final = 100  # Samples
+    _STREAM_BLOCK: Final = 1 << 16  # Samples which are read at once from a live file
 
     def __init__(self):
-
-        self._average_period: int = 8000  # Recommended default value
+        self.configuration = _utilities.load_configuration(DecimationSettings, "pti", "decimation")
+        self.sample_rate = self.configuration.sample_rate  # Hz
+        self._ref_period = self.configuration.ref_period  # Samples
+        self._average_period: int = self.sample_rate  # Recommended default value of 1 s
         self.raw_data = RawData(None, None, None)
-        self.dc_signals: np.ndarray | None = None
+        self.dc_signals: np.ndarray | None = None  # Overwritten in place by every package
         self.lock_in: LockIn = LockIn(np.empty(shape=3), np.empty(shape=3))
         self.save_raw_data: bool = False
         self.destination_folder: str = "."
         self.file_path: str = ""
         self.init_header: bool = True
-        self.use_common_mode_noise_reduction = False
-        self.configuration = _utilities.load_configuration(DecimationSettings, "pti", "decimation")
+        self.path_prefix: str | None = None  # None for the one of the current run, minipti.path_prefix
+        self.common_mode = CommonModeCanceller()
+        self.use_common_mode_noise_reduction = self.common_mode.settings.use
+        self._dc_workspace: np.ndarray | None = None
+        self._ac_workspace: np.ndarray | None = None
+        self._noise_workspace: np.ndarray | None = None  # Noise factor and its share of one channel
+        self.live_file: swmr.LiveFile | None = None
+        offline = _load_offline_decimation()
+        self.window = offline.window  # s
+        self.hop = offline.hop  # s
         self._index = itertools.count()
         self._update_lock_in_look_up_table()
 
@@ -74,21 +152,86 @@ class Decimation:
         self._average_period = average_period
         self._update_lock_in_look_up_table()
 
+    @property
+    def ref_period(self) -> int:
+        return self._ref_period
+
+    @ref_period.setter
+    def ref_period(self, ref_period: int) -> None:
+        self._ref_period = ref_period
+        self._update_lock_in_look_up_table()
+
+    @property
+    def period(self) -> float:
+        """
+        The average period in s.
+        """
+        return self.average_period / self.sample_rate
+
+    def configure_acquisition(self, sample_rate: int, ref_period: int) -> None:
+        """
+        Sets the sample rate in Hz and reference period in samples of the acquired raw data.
+        """
+        self.sample_rate = sample_rate
+        self.ref_period = ref_period
+
+    @staticmethod
+    @functools.lru_cache(maxsize=16)
+    def _look_up_table(average_period: int, ref_period: int) -> tuple[np.ndarray, np.ndarray]:
+        # Cached, so switching between the common periods neither recalculates nor allocates.
+        reference = 2 * np.pi / ref_period * np.arange(0, average_period)
+        in_phase = np.cos(reference)
+        quadrature = np.sin(reference)
+        in_phase.flags.writeable = False
+        quadrature.flags.writeable = False
+        return in_phase, quadrature
+
     def _update_lock_in_look_up_table(self) -> None:
-        self.in_phase: np.ndarray = np.cos(2 * np.pi / Decimation.REF_PERIOD * np.arange(0, self.average_period))
-        self.quadrature: np.ndarray = np.sin(2 * np.pi / Decimation.REF_PERIOD * np.arange(0, self.average_period))
+        self.in_phase, self.quadrature = Decimation._look_up_table(self.average_period, self.ref_period)
+
+    def _follow_package(self) -> None:
+        """
+        The average period is the length of the current package. A change hence happens exactly at a
+        package boundary, and no package is decimated with the look-up table of another period.
+        """
+        samples = np.shape(self.raw_data.ac)[1]
+        if samples != self.average_period:
+            logging.info("Changed average period from %d to %d samples", self.average_period, samples)
+            self.average_period = samples
+
+    @staticmethod
+    def _workspace(workspace: np.ndarray | None, shape: tuple[int, ...]) -> np.ndarray:
+        # The scaled raw data is written into the same arrays every package, so that the
+        # steady state of the live calculation does not allocate.
+        if workspace is None or workspace.shape != shape:
+            return np.empty(shape)
+        return workspace
 
     def process_raw_data(self) -> None:
         """
         Reads the binary data and save it into numpy arrays. The data is saved into npy archives in
         debug mode.
         """
-        self.raw_data.dc = self.raw_data.dc * Decimation.REF_VOLTAGE / self.configuration.dc_resolution
-        self.raw_data.ac = self.raw_data.ac * Decimation.REF_VOLTAGE / (self.configuration.amplification
-                                                                        * self.configuration.ac_resolution)
+        self._dc_workspace = Decimation._workspace(self._dc_workspace, np.shape(self.raw_data.dc))
+        self._ac_workspace = Decimation._workspace(self._ac_workspace, np.shape(self.raw_data.ac))
+        # Casting before scaling avoids the casting buffers of a mixed type multiplication.
+        np.copyto(self._dc_workspace, self.raw_data.dc)
+        np.copyto(self._ac_workspace, self.raw_data.ac)
+        self._dc_workspace *= Decimation.REF_VOLTAGE / self.configuration.dc_resolution
+        self._ac_workspace *= Decimation.REF_VOLTAGE / (self.configuration.amplification
+                                                        * self.configuration.ac_resolution)
+        self.raw_data.dc = self._dc_workspace
+        self.raw_data.ac = self._ac_workspace
+
+    def _file_path(self, name: str) -> str:
+        path_prefix = minipti.path_prefix if self.path_prefix is None else self.path_prefix
+        return f"{self.destination_folder}/{path_prefix}_{name}"
 
     def save(self) -> None:
-        with h5py.File(f"{self.destination_folder}/{minipti.path_prefix}_raw_data.hdf5", "a") as h5f:
+        if self.live_file is not None:
+            self.live_file.append_raw(self.raw_data.ref, self.raw_data.ac, self.raw_data.dc)
+            return
+        with h5py.File(self._file_path("raw_data.hdf5"), "a") as h5f:
             i = str(next(self._index))
             now = datetime.now()
             h5f.create_group(i)
@@ -101,76 +244,194 @@ class Decimation:
         """
         Applies a low pass to the DC-coupled _signals and decimate it to 1 s values.
         """
-        self.dc_signals = np.mean(self.raw_data.dc, axis=1)
+        self.dc_signals = np.mean(self.raw_data.dc, axis=1, out=Decimation._workspace(self.dc_signals,
+                                                                                     np.shape(self.raw_data.dc)[:1]))
 
     def common_mode_noise_reduction(self) -> None:
-        noise_factor = np.sum(self.raw_data.ac, axis=0) / sum(self.dc_signals)
+        if self.common_mode.settings.method == "adaptive":
+            self.raw_data.ac = self.common_mode(self.raw_data.ac, self.raw_data.dc[:3])
+            return
+        self._noise_workspace = Decimation._workspace(self._noise_workspace, (2, np.shape(self.raw_data.ac)[1]))
+        noise_factor, channel_noise = self._noise_workspace
+        np.sum(self.raw_data.ac, axis=0, out=noise_factor)
+        noise_factor /= sum(self.dc_signals)
         for channel in range(3):
-            self.raw_data.ac[channel] = self.raw_data.ac[channel] - noise_factor * self.dc_signals[channel]
+            np.multiply(noise_factor, self.dc_signals[channel], out=channel_noise)
+            self.raw_data.ac[channel] -= channel_noise
 
     def lock_in_amplifier(self) -> None:
-        ac_x = np.mean(self.raw_data.ac * self.in_phase, axis=1)
-        ac_y = np.mean(self.raw_data.ac * self.quadrature, axis=1)
-        self.lock_in.phase = np.arctan2(ac_y, ac_x) % (2 * np.pi)
-        self.lock_in.amplitude = np.sqrt(ac_x ** 2 + ac_y ** 2)
+        amplitude, phase = backend.get("lock_in")(self.raw_data.ac, self.in_phase, self.quadrature)
+        if np.shape(self.lock_in.amplitude) == np.shape(amplitude):
+            self.lock_in.amplitude[:] = amplitude
+            self.lock_in.phase[:] = phase
+        else:  # Replaced by offline lock in data
+            self.lock_in = LockIn(amplitude, phase)
 
     def _calculate_decimation(self) -> None:
         self.calculate_dc()
-        if True:
+        if self.use_common_mode_noise_reduction:
             self.common_mode_noise_reduction()
         self.lock_in_amplifier()
-        output_data = {}
         now = datetime.now()
         date = str(now.strftime("%Y-%m-%d"))
         time = str(now.strftime("%H:%M:%S"))
-        output_data["Time"] = time
+        if self.live_file is not None:
+            self.live_file.append("Decimation", **{"Lock In Amplitude": self.lock_in.amplitude,
+                                                   "Lock In Phase": self.lock_in.phase,
+                                                   "DC": self.dc_signals,
+                                                   "Average Period": self.average_period})
+        output_data = [time]
         for channel in range(3):
-            output_data[f"Lock In Amplitude CH{channel + 1}"] = self.lock_in.amplitude[channel]
-            output_data[f"Lock In Phase CH{channel + 1}"] = self.lock_in.phase[channel]
-            output_data[f"DC CH{channel + 1}"] = self.dc_signals[channel]
-        try:
-            pd.DataFrame(output_data, index=[date]).to_csv(
-                f"{self.destination_folder}/{minipti.path_prefix}_Decimation.csv",
-                mode="a",
-                index_label="Date",
-                header=False
-            )
-        except PermissionError:
-            logging.warning("Could not write data. Missing values are: %s at %s.",
-                            str(output_data)[1:-1], date + " " + time)
+            output_data += [self.lock_in.amplitude[channel], self.lock_in.phase[channel], self.dc_signals[channel]]
+        # Rows of different average periods must not be averaged together, so every row has its period.
+        output_data.append(self.period)
+        _utilities.CSV_ROWS.append(self._file_path("Decimation.csv"), date, output_data)
+
+    def get_raw_data(self) -> Generator[float, None, None]:
+        """
+        Loads the raw data of file_path package by package. If a window is set, the packages are
+        treated as one continuous stream instead, which is re-sliced into windows of this length
+        every hop samples.
 
-    def get_raw_data(self) -> Generator[None, None, None]:
-        with h5py.File(self.file_path, "r") as h5f:
-            for sample_package in h5f.values():
+        Yields:
+            The fraction of already loaded packages or samples.
+        """
+        if self.window:
+            yield from self._get_resliced_raw_data()
+            return
+        with h5py.File(self.file_path, "r", libver="latest", swmr=True) as h5f:
+            self._load_acquisition(h5f)
+            if swmr.is_live_file(h5f):
+                packages = len(h5f["Raw/Time"])
+                for i, (_, ac, dc) in enumerate(swmr.raw_packages(h5f)):
+                    self.raw_data.dc = dc
+                    self.raw_data.ac = ac
+                    self.average_period = self.raw_data.ac.shape[1]
+                    yield (i + 1) / packages
+                return
+            packages = len(h5f)
+            for i, sample_package in enumerate(Decimation._sample_packages(h5f)):
                 self.raw_data.dc = np.array(sample_package["DC"], dtype=np.uint16)
                 self.raw_data.ac = np.array(sample_package["AC"], dtype=np.int16)
                 self.average_period = self.raw_data.ac.shape[1]
-                yield None
+                yield (i + 1) / packages
 
-    def run(self, live=False) -> None:
+    @staticmethod
+    def _sample_packages(h5f: h5py.File) -> list[h5py.Group]:
+        """
+        The packages of a legacy file in the order they were saved. HDF5 iterates groups by name,
+        which puts "10" before "2".
+        """
+        return [h5f[name] for name in sorted(h5f, key=int)]
+
+    @staticmethod
+    def _raw_stream(h5f: h5py.File) -> Generator[tuple[np.ndarray, np.ndarray], None, None]:
+        """
+        Yields consecutive blocks (DC, AC) of the raw data with the channels in the first axis. Only
+        one block is in memory at once.
+        """
+        if swmr.is_live_file(h5f):
+            raw = h5f["Raw"]
+            packages = len(raw["Time"])
+            samples = int(raw["Package"][packages - 1]) if packages else 0
+            for start in range(0, samples, Decimation._STREAM_BLOCK):
+                end = min(start + Decimation._STREAM_BLOCK, samples)
+                yield raw["DC"][start:end].T, raw["AC"][start:end].T
+            return
+        for sample_package in Decimation._sample_packages(h5f):
+            yield np.array(sample_package["DC"], dtype=np.uint16), np.array(sample_package["AC"], dtype=np.int16)
+
+    @staticmethod
+    def _stream_size(h5f: h5py.File) -> int:
+        if swmr.is_live_file(h5f):
+            packages = len(h5f["Raw/Time"])
+            return int(h5f["Raw/Package"][packages - 1]) if packages else 0
+        return sum(sample_package["AC"].shape[1] for sample_package in Decimation._sample_packages(h5f))
+
+    def _load_acquisition(self, h5f: h5py.File) -> None:
+        # Live files know the acquisition they were written with, legacy files use the configured one.
+        acquisition = swmr.acquisition(h5f)
+        if acquisition is not None:
+            self.configure_acquisition(*acquisition)
+
+    def _get_resliced_raw_data(self) -> Generator[float, None, None]:
+        with h5py.File(self.file_path, "r", libver="latest", swmr=True) as h5f:
+            self._load_acquisition(h5f)
+            window = round(self.window * self.sample_rate)
+            hop = round(self.hop * self.sample_rate) if self.hop else window
+            if window % self.ref_period:
+                # Otherwise the lock in would not average over whole reference periods.
+                raise ValueError(f"The window of {window} samples is no multiple of the reference period")
+            if hop % self.ref_period:
+                # Otherwise the windows would not start at the same phase of the reference.
+                raise ValueError(f"The hop of {hop} samples is no multiple of the reference period")
+            samples = Decimation._stream_size(h5f)
+            # The blocks are only joined once enough samples for a window are pending, so every sample is copied
+            # once per window it belongs to instead of once per read block.
+            dc_blocks, ac_blocks = [], []
+            pending = 0
+            skip = 0  # Samples of the next hop which are not read yet
+            read = 0
+            for dc, ac in Decimation._raw_stream(h5f):
+                read += ac.shape[1]
+                skipped = min(skip, ac.shape[1])
+                skip -= skipped
+                dc_blocks.append(dc[:, skipped:])
+                ac_blocks.append(ac[:, skipped:])
+                pending += ac.shape[1] - skipped
+                if pending < window:
+                    continue
+                dc_stream = np.concatenate(dc_blocks, axis=1)
+                ac_stream = np.concatenate(ac_blocks, axis=1)
+                while ac_stream.shape[1] >= window:
+                    self.raw_data.dc = dc_stream[:, :window]
+                    self.raw_data.ac = ac_stream[:, :window]
+                    self.average_period = window
+                    yield (read - ac_stream.shape[1] + window) / samples
+                    skip = max(hop - ac_stream.shape[1], 0)
+                    dc_stream, ac_stream = dc_stream[:, hop:], ac_stream[:, hop:]
+                dc_blocks, ac_blocks = [dc_stream], [ac_stream]
+                pending = ac_stream.shape[1]
+
+    def _init_header(self) -> None:
         if self.init_header:
             output_data = {"Time": "H:M:S"}
             for channel in range(3):
                 output_data[f"Lock In Amplitude CH{channel + 1}"] = "V"
                 output_data[f"Lock In Phase CH{channel + 1}"] = "rad"
                 output_data[f"DC CH{channel + 1}"] = "V"
-            pd.DataFrame(output_data, index=["Y:M:D"]).to_csv(
-                f"{self.destination_folder}/{minipti.path_prefix}_Decimation.csv",
-                index_label="Date"
-            )
+            output_data["Average Period"] = "s"
+            pd.DataFrame(output_data, index=["Y:M:D"]).to_csv(self._file_path("Decimation.csv"), index_label="Date")
             self.init_header = False
+
+    def calculate_offline(self) -> Generator[float, None, None]:
+        """
+        Decimates the raw data of file_path package by package.
+
+        Yields:
+            The fraction of already decimated packages.
+        """
+        self._init_header()
+        for progress in self.get_raw_data():
+            self.process_raw_data()
+            self._calculate_decimation()
+            yield progress
+        backend.SHADOW.join()
+        _utilities.CSV_ROWS.flush()
+        logging.info("Finished decimation")
+        logging.info("Saved results in %s", str(self.destination_folder))
+
+    def run(self, live=False) -> None:
         if live:
+            self._follow_package()
+            self._init_header()
             if self.save_raw_data:
                 self.save()
             self.process_raw_data()
             self._calculate_decimation()
         else:
-            get_raw_data: Generator[None, None, None] = self.get_raw_data()
-            for _ in get_raw_data:
-                self.process_raw_data()
-                self._calculate_decimation()
-            logging.info("Finished decimation")
-            logging.info("Saved results in %s", str(self.destination_folder))
+            for _ in self.calculate_offline():
+                pass
 
 
 @dataclass(frozen=True)
@@ -179,6 +440,107 @@ class InversionSettings:
     sign: int
 
 
+@dataclass(frozen=True)
+class ResponsePhaseTrackingSettings:
+    use: bool = False
+    time_constant: float = 600  # Samples of the slow mean
+    gate_time_constant: float = 10  # Samples of the fast mean for the gate
+    min_amplitude: float = 1e-4  # V
+    max_circular_variance: float = 1e-3
+    min_samples: int = 60  # Gated samples before the first publication
+    min_change: float = 1e-3  # rad, smaller changes are not published
+
+
+def _load_response_phase_tracking() -> ResponsePhaseTrackingSettings:
+    try:
+        return _utilities.load_configuration(ResponsePhaseTrackingSettings, "pti", "response_phase_tracking")
+    except KeyError:
+        return ResponsePhaseTrackingSettings()
+
+
+@dataclass(frozen=True)
+class ResponsePhases:
+    version: int
+    phases: np.ndarray
+    circular_variance: np.ndarray
+
+
+class ResponsePhaseTracker:
+    """
+    Live estimation of the response phases from the lock in phases.
+
+    The lock in phase of a channel is either the response phase or shifted by pi, depending on the
+    slope of the interferometer. Hence the circular statistics are calculated on the doubled angles,
+    for which both are equal. Both means are exponentially weighted and updated recursively, so every
+    sample costs O(1). The fast mean gates the slow one: only samples with a strong signal and a
+    stable phase, i.e. a small circular variance of the fast mean, enter the estimation.
+    Whenever the estimation moved by more than min_change, it is published with a new version.
+    """
+    CONFIGURATION: Final[ResponsePhaseTrackingSettings] = _load_response_phase_tracking()
+
+    def __init__(self, channels: int = 3, settings: ResponsePhaseTrackingSettings | None = None):
+        self.settings = ResponsePhaseTracker.CONFIGURATION if settings is None else settings
+        self._slow_weight = 1 / self.settings.time_constant
+        self._fast_weight = 1 / self.settings.gate_time_constant
+        self._slow_mean = np.zeros(channels, dtype=complex)
+        self._fast_mean = np.zeros(channels, dtype=complex)
+        self._fast_samples = np.zeros(channels, dtype=int)
+        self.gated_samples = np.zeros(channels, dtype=int)
+        self.published = ResponsePhases(0, np.full(channels, np.nan), np.ones(channels))
+
+    def __repr__(self) -> str:
+        class_name = self.__class__.__name__
+        return f"{class_name}(published={self.published}, gated_samples={self.gated_samples})"
+
+    @property
+    def estimation(self) -> np.ndarray:
+        return np.angle(self._slow_mean) / 2 % np.pi
+
+    @property
+    def circular_variance(self) -> np.ndarray:
+        # The slow mean is not normalised before its weights sum up to 1.
+        weights = 1 - (1 - self._slow_weight) ** self.gated_samples
+        with np.errstate(divide="ignore", invalid="ignore"):
+            return np.where(weights > 0, 1 - np.abs(self._slow_mean) / weights, 1)
+
+    def update(self, amplitude: np.ndarray, phase: np.ndarray) -> bool:
+        """
+        Adds one lock in sample of every channel.
+        Returns:
+            True if new response phases have been published.
+        """
+        doubled = np.exp(2j * np.asarray(phase))
+        self._fast_mean += self._fast_weight * (doubled - self._fast_mean)
+        self._fast_samples += 1
+        fast_weights = 1 - (1 - self._fast_weight) ** self._fast_samples
+        # The variance of the fast mean is meaningless before it saw a time constant of samples.
+        gate = (np.asarray(amplitude) >= self.settings.min_amplitude) \
+            & (self._fast_samples >= self.settings.gate_time_constant) \
+            & (1 - np.abs(self._fast_mean) / fast_weights <= self.settings.max_circular_variance)
+        self._slow_mean[gate] += self._slow_weight * (doubled[gate] - self._slow_mean[gate])
+        self.gated_samples[gate] += 1
+        return self._publish()
+
+    def _publish(self) -> bool:
+        ready = self.gated_samples >= self.settings.min_samples
+        if not np.any(ready):
+            return False
+        estimation = np.where(ready, self.estimation, self.published.phases)
+        change = np.angle(np.exp(2j * (estimation - self.published.phases))) / 2
+        if np.all(np.abs(np.nan_to_num(change, nan=np.inf)[ready]) < self.settings.min_change):
+            return False
+        self.published = ResponsePhases(self.published.version + 1, estimation, self.circular_variance)
+        logging.info("Published response phases %s (version %i)", estimation, self.published.version)
+        return True
+
+    def reset(self) -> None:
+        self._slow_mean[:] = 0
+        self._fast_mean[:] = 0
+        self._fast_samples[:] = 0
+        self.gated_samples[:] = 0
+
+
+
 class Inversion:
     """
     Provided an API for the PTI algorithm described in [1] from Weingartner et al.
@@ -208,6 +570,9 @@ class Inversion:
         self.interferometer: interferometry.Interferometer = interferometer
         self.decimation = decimation
         self.destination_folder: str = os.getcwd()
+        self.live_file: swmr.LiveFile | None = None
+        self.response_phase_tracker: ResponsePhaseTracker | None = None
+        self.response_phase_version: int = 0
         self.load_response_phase()
 
     def __repr__(self) -> str:
@@ -232,12 +597,30 @@ class Inversion:
         settings = pd.read_csv(self.settings_path, index_col="Setting")
         self.response_phases = settings.loc["Response Phases [rad]"].to_numpy()
 
-    def _calculate_sign(self, channel: int) -> int:
+    def track_response_phase(self) -> bool:
+        """
+        Updates the response phase tracker with the current lock in data and takes over its
+        response phases if a new version has been published.
+        Returns:
+            True if the response phases changed.
+        """
+        if self.response_phase_tracker is None:
+            return False
+        self.response_phase_tracker.update(self.decimation.lock_in.amplitude, self.decimation.lock_in.phase)
+        published = self.response_phase_tracker.published
+        if published.version <= self.response_phase_version:
+            return False
+        # Channels without estimation yet keep their loaded response phase.
+        self.response_phases = np.where(np.isnan(published.phases), self.response_phases, published.phases)
+        self.response_phase_version = published.version
+        return True
+
+    def _calculate_sign(self, output_phase: float) -> int:
         try:
             sign = np.ones(shape=len(self.interferometer.phase))
-            sign[np.sin(self.interferometer.phase - self.interferometer.output_phases[channel]) < 0] = -1
+            sign[np.sin(self.interferometer.phase - output_phase) < 0] = -1
         except TypeError:
-            sign = 1 if np.sin(self.interferometer.phase - self.interferometer.output_phases[channel]) >= 0 else -1
+            sign = 1 if np.sin(self.interferometer.phase - output_phase) >= 0 else -1
         return sign
 
     def calculate_pti_signal(self) -> None:
@@ -245,8 +628,10 @@ class Inversion:
             pti_signal = np.zeros(shape=(len(self.interferometer.phase)))
         except TypeError:
             pti_signal = 0
+        # One snapshot for all channels, the characterisation thread may publish new output phases meanwhile.
+        output_phases = self.interferometer.characteristic_parameter.output_phases
         for channel in range(3):
-            sign = self._calculate_sign(channel)
+            sign = self._calculate_sign(output_phases[channel])
             response_phase = self.response_phases[channel]
             demodulated_signal = self.decimation.lock_in.amplitude[channel] * np.cos(
                 self.decimation.lock_in.phase[channel] - response_phase)
@@ -272,13 +657,23 @@ class Inversion:
         else:
             raise KeyError("Invalid Keys for Lock In or Lock In Data not existing")
 
-    def _calculate_offline(self, file_path: str) -> None:
+    def calculate_offline(self, file_path: str) -> Generator[float, None, None]:
+        """
+        Calculates the PTI signal of the decimated data in file_path.
+
+        Yields:
+            The fraction of samples of which the interferometric phase is already calculated.
+        """
         if file_path:
             self._get_lock_in_data(file_path)
-        self.interferometer.run(file_path=file_path)
+        yield from self.interferometer.calculate_offline(file_path)
         self.calculate_pti_signal()
         self._save_data()
 
+    def _calculate_offline(self, file_path: str) -> None:
+        for _ in self.calculate_offline(file_path):
+            pass
+
     def _save_data(self) -> None:
         units: dict[str, str] = {"PTI Signal": "µrad"}
         output_data = {"PTI Signal": self.pti_signal}
@@ -301,6 +696,7 @@ class Inversion:
                 index_label="Date"
             )
             self.init_header = False
+        self.track_response_phase()
         self.calculate_pti_signal()
         self._save_live_data()
 
@@ -309,18 +705,10 @@ class Inversion:
         date = str(now.strftime("%Y-%m-%d"))
         time = str(now.strftime("%H:%M:%S"))
         output_data = {"Time": time, "PTI Signal": self.pti_signal}
-        try:
-            pd.DataFrame(output_data, index=[date]).to_csv(
-                f"{self.destination_folder}/{minipti.path_prefix}_PTI_Inversion.csv",
-                mode="a",
-                index_label="Date",
-                header=False
-            )
-        except PermissionError:
-            logging.warning(
-                "Could not write data. Missing values are: %s at %s.",
-                str(output_data)[1:-1], date + " " + time
-            )
+        if self.live_file is not None:
+            self.live_file.append("PTI Inversion", **{"PTI Signal": self.pti_signal})
+        _utilities.CSV_ROWS.append(f"{self.destination_folder}/{minipti.path_prefix}_PTI_Inversion.csv", date,
+                                   output_data.values())
 
     def run(self, live=False, file_path="") -> None:
         if live:
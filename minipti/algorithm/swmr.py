@@ -0,0 +1,183 @@
+"""
+Live HDF5 output in single writer multiple reader (SWMR) mode.
+
+All products of a live measurement are appended to extendable datasets of one file. Readers
+can open the file while it is written, e.g. with follow() or with
+h5py.File(file_path, "r", libver="latest", swmr=True). Every group has a "Time" dataset
+(UNIX time in s), which is extended after all other datasets of the group. Its length is hence
+the number of rows that are complete in every dataset of the group.
+Raw data is saved sample wise in the group "Raw". Its "Package" dataset contains the end index
+of every package.
+"""
+import threading
+import time
+from collections.abc import Generator
+from typing import Final
+
+import h5py
+import numpy as np
+
+
+# Group -> dataset -> (shape of one row, dtype)
+SCHEMA: Final = {
+    "Decimation": {
+        "Lock In Amplitude": ((3,), np.float64),
+        "Lock In Phase": ((3,), np.float64),
+        "DC": ((3,), np.float64),
+        "Average Period": ((), np.int64)  # Samples
+    },
+    "Interferometer": {
+        "Interferometric Phase": ((), np.float64),
+        "Sensitivity": ((3,), np.float64)
+    },
+    "PTI Inversion": {
+        "PTI Signal": ((), np.float64)
+    },
+    "Characterisation": {
+        "Output Phases": ((3,), np.float64),
+        "Amplitudes": ((3,), np.float64),
+        "Offsets": ((3,), np.float64)
+    },
+    "Raw": {
+        "Package": ((), np.int64)
+    }
+}
+
+RAW_SAMPLES: Final = {
+    "Ref": ((), np.uint16),
+    "AC": ((3,), np.int16),
+    "DC": ((3,), np.uint16)
+}
+
+_CHUNK_ROWS: Final = 256
+_RAW_CHUNK_ROWS: Final = 8000
+
+
+class LiveFile:
+    """
+    Writer of a live HDF5 file. It is thread safe, so every calculation thread can append its
+    products to the same file.
+    """
+    def __init__(self, file_path: str, sample_rate: int = 8000, ref_period: int = 100):
+        """
+        Args:
+            sample_rate (int): Samples per s of the raw data.
+            ref_period (int): Samples per period of the reference.
+        """
+        self.file_path = file_path
+        self._lock = threading.Lock()
+        self._file = h5py.File(file_path, "w", libver="latest")
+        # SWMR requires that every dataset exists before the mode is switched on.
+        for group, datasets in SCHEMA.items():
+            for name, (shape, dtype) in (datasets | {"Time": ((), np.float64)}).items():
+                self._create_dataset(f"{group}/{name}", shape, dtype, _CHUNK_ROWS)
+        for name, (shape, dtype) in RAW_SAMPLES.items():
+            self._create_dataset(f"Raw/{name}", shape, dtype, _RAW_CHUNK_ROWS)
+        self._file["Raw"].attrs["Sample Rate"] = sample_rate
+        self._file["Raw"].attrs["Reference Period"] = ref_period
+        self._file.swmr_mode = True
+
+    def __repr__(self) -> str:
+        class_name = self.__class__.__name__
+        return f"{class_name}(file_path={self.file_path})"
+
+    def _create_dataset(self, name: str, shape: tuple, dtype: type, chunk_rows: int) -> None:
+        self._file.create_dataset(name, shape=(0, *shape), maxshape=(None, *shape), dtype=dtype,
+                                  chunks=(chunk_rows, *shape))
+
+    @property
+    def closed(self) -> bool:
+        return not self._file.id.valid
+
+    def append(self, group: str, **columns: np.ndarray | float) -> None:
+        """
+        Appends one row to every given dataset of group and marks it as complete.
+        """
+        with self._lock:
+            if self.closed:
+                return
+            for name, value in columns.items():
+                self._extend(self._file[group][name], np.asarray(value)[np.newaxis])
+            self._extend(self._file[group]["Time"], np.array([time.time()]))
+
+    def append_raw(self, ref: np.ndarray, ac: np.ndarray, dc: np.ndarray) -> None:
+        """
+        Appends a package of raw data. The channels of AC and DC are expected in the first axis.
+        """
+        with self._lock:
+            if self.closed:
+                return
+            raw = self._file["Raw"]
+            self._extend(raw["Ref"], np.asarray(ref))
+            self._extend(raw["AC"], np.asarray(ac).T)
+            self._extend(raw["DC"], np.asarray(dc).T)
+            self._extend(raw["Package"], np.array([raw["Ref"].shape[0]]))
+            self._extend(raw["Time"], np.array([time.time()]))
+
+    @staticmethod
+    def _extend(dataset: h5py.Dataset, rows: np.ndarray) -> None:
+        size = dataset.shape[0]
+        dataset.resize(size + rows.shape[0], axis=0)
+        dataset[size:] = rows
+        dataset.flush()
+
+    def close(self) -> None:
+        with self._lock:
+            if not self.closed:
+                self._file.close()
+
+
+def is_live_file(h5f: h5py.File) -> bool:
+    return "Raw" in h5f and "Package" in h5f["Raw"]
+
+
+def acquisition(h5f: h5py.File) -> tuple[int, int] | None:
+    """
+    The sample rate in Hz and the reference period in samples of the raw data, if they are stored.
+    """
+    if not is_live_file(h5f) or "Sample Rate" not in h5f["Raw"].attrs:
+        return None
+    return int(h5f["Raw"].attrs["Sample Rate"]), int(h5f["Raw"].attrs["Reference Period"])
+
+
+def raw_packages(h5f: h5py.File) -> Generator[tuple[np.ndarray, np.ndarray, np.ndarray], None, None]:
+    """
+    Yields the complete raw data packages (Ref, AC, DC) of a live file with the channels in the first axis.
+    """
+    raw = h5f["Raw"]
+    packages = len(raw["Time"])
+    start = 0
+    for end in raw["Package"][:packages]:
+        yield raw["Ref"][start:end], raw["AC"][start:end].T, raw["DC"][start:end].T
+        start = end
+
+
+def follow(file_path: str, group: str, poll_interval: float = 0.1,
+           timeout: float | None = None) -> Generator[dict[str, np.ndarray], None, None]:
+    """
+    Yields the new complete rows of every dataset in group while the file is written.
+    Args:
+        file_path (str): Path to the live file.
+        group (str): The group of the product, e.g. "PTI Inversion". Raw samples are not rows of
+            their group, hence only the package indices are followed for "Raw".
+        poll_interval (float): Time in s between two checks for new rows.
+        timeout (float): Stops after this time in s without new rows. None follows forever.
+    """
+    with h5py.File(file_path, "r", libver="latest", swmr=True) as h5f:
+        datasets: dict[str, h5py.Dataset] = {name: dataset for name, dataset in h5f[group].items()
+                                             if group != "Raw" or name not in RAW_SAMPLES}
+        read = 0
+        last_row = time.monotonic()
+        while timeout is None or time.monotonic() - last_row < timeout:
+            datasets["Time"].refresh()
+            rows = datasets["Time"].shape[0]
+            if rows > read:
+                new_rows = {}
+                for name, dataset in datasets.items():
+                    dataset.refresh()
+                    new_rows[name] = dataset[read:rows]
+                read = rows
+                last_row = time.monotonic()
+                yield new_rows
+            else:
+                time.sleep(poll_interval)
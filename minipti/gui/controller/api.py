@@ -1,6 +1,7 @@
 import abc
 import logging
 import os
+import signal
 import threading
 import typing
 from dataclasses import dataclass
@@ -64,6 +65,19 @@ class MainApplication(interface.MainApplication):
             target=model.general_purpose.theme_observer,
             daemon=True
         ).start()
+        if model.configuration.GUI.load.use:
+            threading.Thread(
+                target=model.load.SAMPLER.run,
+                args=(model.configuration.GUI.load.interval, model.configuration.GUI.load.log_interval),
+                name="Load Sampler",
+                daemon=True
+            ).start()
+        if model.configuration.GUI.utilities.profiler.use and hasattr(signal, "SIGUSR1"):
+            # Python handles signals only while it runs, so the timer wakes it up while Qt waits for events.
+            signal.signal(signal.SIGUSR1, lambda *_: self.controllers.utilities.toggle_profiler())
+            self._signal_timer = QtCore.QTimer()
+            self._signal_timer.timeout.connect(lambda: None)
+            self._signal_timer.start(500)
         self.controllers.toolbar.init_devices()
         self.setFont(QtGui.QFont('Arial', 11))
         splash.finish(self.view)
@@ -80,6 +94,7 @@ class MainApplication(interface.MainApplication):
         model.serial_devices.DRIVER.motherboard.clear()
         model.serial_devices.DRIVER.tec.clear()
         model.serial_devices.DRIVER.laser.clear()
+        self.controllers.utilities.calculation_model.jobs.shutdown()
 
     @QtCore.pyqtSlot(str)
     def update_theme(self, theme: str) -> None:
@@ -325,10 +340,11 @@ class Settings(interface.Settings):
         self._settings_table = model.processing.SettingsTable()
         self.view = view.settings.SettingsWindow(self)
         self.last_file_path = os.getcwd()
-        self.calculation_model.set_common_mode_noise_reduction(False)
+        # The initial state is the one of algorithm.json, which the offline decimation uses as well.
+        common_mode_noise_reduction = self.calculation_model.pti.decimation.use_common_mode_noise_reduction
         if model.configuration.GUI.settings.measurement_settings:
             self.view.measurement_configuration.measurement_options.common_mode_noise_rejection.setChecked(
-                False
+                common_mode_noise_reduction
             )
         if model.configuration.GUI.settings.pump:
             self.view.pump_configuration.enable.setChecked(True)
@@ -495,20 +511,17 @@ class Settings(interface.Settings):
 
     @override
     def update_sample_setting(self) -> None:
+        # While the DAQ runs, the new period starts with the next package.
         sample_settings = self.view.measurement_configuration.sample_settings
-        if model.serial_devices.TOOLS.daq.running:
-            logging.error("Cannot change sample rate while DAQ is running")
-            sample_settings.average_period.setCurrentIndex(sample_settings.last_period)
-            return
         self.update_samples(sample_settings.average_period.currentText())
 
     def update_samples(self, average_period: str) -> None:
+        sample_rate = model.serial_devices.TOOLS.daq.sample_rate
         if average_period[-2:] == "ms":
-            samples = int((float(average_period[:-3]) / 1000) * 8000)
+            samples = round(float(average_period[:-3]) / 1000 * sample_rate)
         else:
-            samples = int(float(average_period[:-2]) * 8000)
+            samples = round(float(average_period[:-2]) * sample_rate)
         model.serial_devices.TOOLS.daq.number_of_samples = samples
-        self.calculation_model.pti.decimation.average_period = samples
         self.view.measurement_configuration.sample_settings.samples.setText(f"{samples} Samples")
 
 
@@ -516,6 +529,10 @@ class Utilities(interface.Utilities):
     def __init__(self):
         self.view = view.utilities.UtilitiesWindow(self)
         self.calculation_model = model.processing.OfflineCalculation()
+        self.profiler = model.profiler.Profiler(model.configuration.GUI.utilities.profiler.interval,
+                                                model.configuration.GUI.utilities.profiler.format)
+        self.command_latency = model.serial_devices.CommandLatency()
+        self.command_latency_view = view.utilities.CommandLatencyWindow(self, self.command_latency.tables)
         self.last_file_path = os.getcwd()
         model.signals.CALCULATION.dc_signals.connect(view.plots.dc_offline)
         model.signals.CALCULATION.inversion.connect(view.plots.pti_signal_offline)
@@ -530,8 +547,7 @@ class Utilities(interface.Utilities):
                                                                    "HDF5 File (*.hdf5);; All Files (*)")
         if not decimation_file_path:
             return
-        threading.Thread(target=self.calculation_model.calculate_decimation,
-                         args=[decimation_file_path]).start()
+        self.calculation_model.submit_decimation(decimation_file_path)
 
     @override
     def plot_dc(self) -> None:
@@ -550,7 +566,7 @@ class Utilities(interface.Utilities):
                                                                   "CSV File (*.csv);; TXT File (*.txt);; All Files (*)")
         if not interferometry_path:
             return
-        threading.Thread(target=self.calculation_model.calculate_interferometry, args=[interferometry_path]).start()
+        self.calculation_model.submit_interferometry(interferometry_path)
 
     @override
     def calculate_response_phases(self) -> None:
@@ -567,7 +583,7 @@ class Utilities(interface.Utilities):
                                                              "CSV File (*.csv);; TXT File (*.txt);; All Files (*)")
         if not inversion_path:
             return
-        threading.Thread(target=self.calculation_model.calculate_inversion, args=[inversion_path]).start()
+        self.calculation_model.submit_inversion(inversion_path)
 
     @override
     def plot_inversion(self) -> None:
@@ -627,10 +643,27 @@ class Utilities(interface.Utilities):
                                                                     " All Files (*)")
         if not characterisation_path:
             return
-        threading.Thread(
-            target=self.calculation_model.calculate_characterisation,
-            args=[characterisation_path]
-        ).start()
+        self.calculation_model.submit_characterisation(characterisation_path)
+
+    @override
+    def cancel_calculations(self) -> None:
+        self.calculation_model.jobs.cancel_all()
+
+    @override
+    def toggle_profiler(self) -> None:
+        self.profiler.toggle()
+
+    @override
+    def show_command_latency(self) -> None:
+        self.command_latency_view.show()
+
+    @override
+    def update_command_latency(self) -> None:
+        self.command_latency.update()
+
+    @override
+    def save_command_latency(self) -> None:
+        self.command_latency.save()
 
     @override
     def plot_characterisation(self) -> None:
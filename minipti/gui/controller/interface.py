@@ -233,10 +233,30 @@ class Utilities(ABC):
     def calculate_characterisation(self) -> None:
         ...
 
+    @abstractmethod
+    def cancel_calculations(self) -> None:
+        ...
+
     @abstractmethod
     def plot_characterisation(self) -> None:
         ...
 
+    @abstractmethod
+    def toggle_profiler(self) -> None:
+        ...
+
+    @abstractmethod
+    def show_command_latency(self) -> None:
+        ...
+
+    @abstractmethod
+    def update_command_latency(self) -> None:
+        ...
+
+    @abstractmethod
+    def save_command_latency(self) -> None:
+        ...
+
 
 class Driver(ABC):
     @abstractmethod
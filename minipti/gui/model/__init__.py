@@ -1,6 +1,11 @@
 from . import configuration
 from . import buffer
 from . import general_purpose
+from . import history
+from . import jobs
+from . import load
+from . import power
 from . import processing
+from . import profiler
 from . import serial_devices
 from . import signals
@@ -1,232 +1,301 @@
+import dataclasses
 import itertools
+import threading
 import typing
 from abc import abstractmethod
 from collections import deque
+from dataclasses import dataclass, field
 
 import numpy as np
 from overrides import override
 
 from minipti import algorithm, hardware
-from minipti.gui.model import configuration
+from minipti.gui.model import configuration, history
+
+
+class Ring:
+    """
+    Preallocated ring of rows with one column per series. Every row is written twice, at i and
+    i + capacity, hence the last size rows are always contiguous and can be returned as view
+    without copying. The capacity exceeds size by slack rows, so a returned view is not
+    overwritten before slack further rows have been appended.
+    Only one thread may append to a ring.
+    """
+    def __init__(self, columns: int, size: int, slack: int):
+        self.size = size
+        self.slack = slack
+        self.capacity = size + slack
+        self.columns = columns
+        self._rows = np.full((columns, 2 * self.capacity), np.nan)
+        self.written = 0
+        self._start = 0
+
+    def __len__(self) -> int:
+        return min(self.written - self._start, self.size)
+
+    def append(self, row: typing.Sequence[float]) -> None:
+        index = self.written % self.capacity
+        self._rows[:, index] = row
+        self._rows[:, index + self.capacity] = row
+        self.written += 1
+
+    def clear(self) -> None:
+        # Already published views stay untouched, only the next window starts empty.
+        self._start = self.written
+
+    def window(self) -> np.ndarray:
+        """
+        Read only view of the last rows with the columns in the first axis.
+        """
+        end = (self.written - 1) % self.capacity + self.capacity + 1
+        window = self._rows[:, end - len(self):end]
+        window.flags.writeable = False
+        return window
+
+
+@dataclass(frozen=True, eq=False)
+class Snapshot:
+    """
+    Immutable frame of a buffer, which the writer publishes instead of the buffer itself. Its arrays
+    are views into the ring of the buffer. They are consistent as long as valid, i.e. until the
+    writer has appended more than slack further rows. Readers check this without locking, like the
+    sequence of a seqlock, after they have read the arrays. Snapshots of the history own their
+    arrays and have no sequence.
+    """
+    time: np.ndarray
+    source: "BaseClass" = field(repr=False)
+    sequence: int | None
+
+    @property
+    def valid(self) -> bool:
+        return self.sequence is None or self.source.overtaken(self.sequence) <= self.source.SLACK
+
+    def owned(self) -> typing.Self:
+        """
+        Copy with its own arrays, e.g. for a plot which keeps them. It is only consistent if the
+        snapshot is still valid after the copy.
+        """
+        arrays = {snapshot_field.name: np.array(getattr(self, snapshot_field.name))
+                  for snapshot_field in dataclasses.fields(self)
+                  if isinstance(getattr(self, snapshot_field.name), np.ndarray)}
+        return dataclasses.replace(self, sequence=None, **arrays)
 
 
 class BaseClass:
     """
-    The buffer contains the queues for incoming data and the timer for them.
+    The buffer contains the ring for incoming data, the history of the whole session and the timer
+    for them. The first column of the ring is the time.
     """
     QUEUE_SIZE = configuration.GUI.live_plot_size
+    SLACK = QUEUE_SIZE  # Rows after which a snapshot may be overwritten
 
-    def __init__(self):
+    def __init__(self, columns: int):
         self.time_counter = itertools.count()
-        self.time = deque(maxlen=BaseClass.QUEUE_SIZE)
+        self._ring = Ring(columns + 1, BaseClass.QUEUE_SIZE, BaseClass.SLACK)
+        self.history = self._new_history()
+        self._clear_requested = threading.Event()
+
+    def _new_history(self) -> history.History:
+        return history.History(self._ring.columns - 1, configuration.GUI.history.chunk_size,
+                               configuration.GUI.history.resident_chunks)
 
     @property
-    @abstractmethod
     def is_empty(self) -> bool:
-        ...
+        return len(self._ring) == 0
 
     @abstractmethod
     def append(self, *args: typing.Any) -> None:
         ...
 
+    def _append(self, time: float, *values: float) -> None:
+        self._ring.append((time, *values))
+        self.history.append(time, values)
 
-class _DAQ(BaseClass):
-    CHANNELS = 3
+    def overtaken(self, sequence: int) -> int:
+        return self._ring.written - sequence
 
-    def __init__(self):
-        BaseClass.__init__(self)
-        # signals.DAQ.clear.connect(self.clear)
+    def request_clear(self) -> None:
+        """
+        Clears the buffer before the next append, so only the writer thread changes the ring and the
+        history. May be called by any thread.
+        """
+        self._clear_requested.set()
+
+    def _clear_if_requested(self) -> None:
+        """
+        Must be called by the writer thread at the start of every append.
+        """
+        if self._clear_requested.is_set():
+            self._clear_requested.clear()
+            self.clear()
 
-    @abstractmethod
     def clear(self) -> None:
         """
-        Resets all buffers.
+        Resets all buffers and starts a new history. Must be called by the writer thread.
         """
+        self.time_counter = itertools.count()
+        self._ring.clear()
+        self.history.close()
+        self.history = self._new_history()
 
+    def snapshot(self) -> Snapshot:
+        """
+        The last entries of the buffer. Must be called by the writer thread.
+        """
+        return self._snapshot(self._ring.window(), self._ring.written)
 
-class PTI(_DAQ):
-    MEAN_SIZE = 60
+    def history_snapshot(self, start: float, end: float, points: int = configuration.GUI.history.points) -> Snapshot:
+        """
+        The entries between start and end, reduced to their envelope if there are more than points.
+        """
+        return self._snapshot(self.history.window(start, end, points), None)
 
-    def __init__(self):
-        _DAQ.__init__(self)
-        self._pti_signal = deque(maxlen=BaseClass.QUEUE_SIZE)
-        self._pti_signal_mean = deque(maxlen=BaseClass.QUEUE_SIZE)
-        self._pti_signal_median = deque(maxlen=BaseClass.QUEUE_SIZE)
-        self._pti_signal_mean_queue = deque(maxlen=PTI.MEAN_SIZE)
+    @abstractmethod
+    def _snapshot(self, window: np.ndarray, sequence: int | None) -> Snapshot:
+        ...
 
-    @property
-    @override
-    def is_empty(self) -> bool:
-        return len(self._pti_signal) == 0
 
-    def append(self, pti, average_period: int) -> None:
-        self._pti_signal.append(pti.inversion.pti_signal)
-        self._pti_signal_mean_queue.append(pti.inversion.pti_signal)
-        if average_period == algorithm.pti.Decimation.SAMPLE_PERIOD:
-            self._pti_signal_mean.append(np.mean(np.array(self._pti_signal_mean_queue)))
-            self._pti_signal_median.append(np.median(np.array(self._pti_signal_mean_queue)))
-        time_scaler = average_period / algorithm.pti.Decimation.SAMPLE_PERIOD
-        self.time.append(next(self.time_counter) * time_scaler)
+class _DAQ(BaseClass):
+    CHANNELS = 3
 
-    @property
-    def pti_signal(self) -> deque[float]:
-        return self._pti_signal
 
-    @property
-    def pti_signal_mean(self) -> deque[float]:
-        return self._pti_signal_mean
+@dataclass(frozen=True, eq=False)
+class PTISnapshot(Snapshot):
+    pti_signal: np.ndarray
+    pti_signal_mean: np.ndarray
+    pti_signal_median: np.ndarray
 
-    @property
-    def pti_signal_median(self) -> deque[float]:
-        return self._pti_signal_median
 
-    @override
-    def clear(self) -> None:
-        self.time_counter = itertools.count()
-        self.time = deque(maxlen=BaseClass.QUEUE_SIZE)
-        self._pti_signal = deque(maxlen=BaseClass.QUEUE_SIZE)
-        self._pti_signal_mean = deque(maxlen=BaseClass.QUEUE_SIZE)
-        self._pti_signal_median = deque(maxlen=BaseClass.QUEUE_SIZE)
+class PTI(_DAQ):
+    MEAN_SIZE = 60
+
+    def __init__(self):
+        _DAQ.__init__(self, columns=3)
         self._pti_signal_mean_queue = deque(maxlen=PTI.MEAN_SIZE)
+        self._time = 0.
+        self._period: float | None = None
 
+    def append(self, pti, period: float) -> None:
+        """
+        Args:
+            period (float): The average period in s.
+        """
+        self._clear_if_requested()
+        if period != self._period:
+            # The mean and median do not mix values of different average periods.
+            self._pti_signal_mean_queue.clear()
+            self._period = period
+        self._pti_signal_mean_queue.append(pti.inversion.pti_signal)
+        if period == 1:
+            mean = np.mean(self._pti_signal_mean_queue)
+            median = np.median(self._pti_signal_mean_queue)
+        else:
+            mean = median = np.nan
+        self._append(self._time, pti.inversion.pti_signal, mean, median)
+        # The time is accumulated, so it stays continuous if the average period changes.
+        self._time += period
 
-class Interferometer(_DAQ):
-    def __init__(self):
-        _DAQ.__init__(self)
-        self._dc_values = [deque(maxlen=BaseClass.QUEUE_SIZE) for _ in range(PTI.CHANNELS)]
-        self._interferometric_phase = deque(maxlen=BaseClass.QUEUE_SIZE)
-        self._sensitivity = [deque(maxlen=BaseClass.QUEUE_SIZE) for _ in range(PTI.CHANNELS)]
+    @override
+    def _snapshot(self, window: np.ndarray, sequence: int | None) -> PTISnapshot:
+        return PTISnapshot(window[0], self, sequence, *window[1:])
 
-    @property
     @override
-    def is_empty(self) -> bool:
-        return len(self._interferometric_phase) == 0
+    def clear(self) -> None:
+        _DAQ.clear(self)
+        self._pti_signal_mean_queue.clear()
+        self._time = 0.
 
-    @property
-    def dc_values(self) -> list[deque[float]]:
-        return self._dc_values
 
-    @property
-    def interferometric_phase(self) -> deque[float]:
-        return self._interferometric_phase
+@dataclass(frozen=True, eq=False)
+class InterferometerSnapshot(Snapshot):
+    dc_values: np.ndarray
+    interferometric_phase: np.ndarray
+    sensitivity: np.ndarray
 
-    @property
-    def sensitivity(self) -> list[deque[float]]:
-        return self._sensitivity
+
+class Interferometer(_DAQ):
+    def __init__(self):
+        _DAQ.__init__(self, columns=2 * _DAQ.CHANNELS + 1)
 
     def append(self, interferometer: algorithm.interferometry.Interferometer) -> None:
-        for i in range(Interferometer.CHANNELS):
-            self._dc_values[i].append(interferometer.intensities[i])
-            self._sensitivity[i].append(interferometer.sensitivity[i])
-        self._interferometric_phase.append(interferometer.phase)
-        self.time.append(next(self.time_counter))
+        self._clear_if_requested()
+        self._append(next(self.time_counter), *interferometer.intensities, interferometer.phase,
+                     *interferometer.sensitivity)
 
     @override
-    def clear(self) -> None:
-        self.time_counter = itertools.count()
-        self.time = deque(maxlen=BaseClass.QUEUE_SIZE)
-        self._dc_values = [deque(maxlen=BaseClass.QUEUE_SIZE) for _ in range(PTI.CHANNELS)]
-        self._interferometric_phase = deque(maxlen=BaseClass.QUEUE_SIZE)
-        self._sensitivity = [deque(maxlen=BaseClass.QUEUE_SIZE) for _ in range(PTI.CHANNELS)]
+    def _snapshot(self, window: np.ndarray, sequence: int | None) -> InterferometerSnapshot:
+        channels = _DAQ.CHANNELS
+        return InterferometerSnapshot(window[0], self, sequence, window[1:channels + 1],
+                                      window[channels + 1], window[channels + 2:])
+
+
+@dataclass(frozen=True, eq=False)
+class CharacterisationSnapshot(Snapshot):
+    output_phases: np.ndarray
+    amplitudes: np.ndarray
+    symmetry: np.ndarray
+    relative_symmetry: np.ndarray
 
 
 class Characterisation(_DAQ):
     def __init__(self):
-        _DAQ.__init__(self)
         # The first channel has always the phase 0 by definition hence it is not needed.
-        self._output_phases = [deque(maxlen=BaseClass.QUEUE_SIZE) for _ in range(_DAQ.CHANNELS - 1)]
-        self._amplitudes = [deque(maxlen=BaseClass.QUEUE_SIZE) for _ in range(_DAQ.CHANNELS)]
-        self._symmetry = deque(maxlen=BaseClass.QUEUE_SIZE)
-        self._relative_symmetry = deque(maxlen=BaseClass.QUEUE_SIZE)
-
-    @property
-    def is_empty(self) -> bool:
-        return len(self._output_phases) == 0
+        _DAQ.__init__(self, columns=2 * _DAQ.CHANNELS + 1)
 
     def append(self, characterization: algorithm.interferometry.Characterization) -> None:
-        for i in range(3):
-            self._amplitudes[i].append(characterization.interferometer.amplitudes[i])
-        for i in range(2):
-            self._output_phases[i].append(characterization.interferometer.output_phases[i + 1])
-        self.symmetry.append(characterization.interferometer.symmetry.absolute)
-        self.relative_symmetry.append(characterization.interferometer.symmetry.relative)
-        self.time.append(characterization.time_stamp)
-
-    @property
-    def output_phases(self) -> list[deque[float]]:
-        return self._output_phases
+        self._clear_if_requested()
+        interferometer = characterization.interferometer
+        parameter = interferometer.characteristic_parameter
+        self._append(characterization.time_stamp, *parameter.output_phases[1:], *parameter.amplitudes,
+                     interferometer.symmetry.absolute, interferometer.symmetry.relative)
 
-    @property
-    def amplitudes(self) -> list[deque[float]]:
-        return self._amplitudes
-
-    @property
-    def symmetry(self) -> deque[float]:
-        return self._symmetry
+    @override
+    def _snapshot(self, window: np.ndarray, sequence: int | None) -> CharacterisationSnapshot:
+        channels = _DAQ.CHANNELS
+        return CharacterisationSnapshot(window[0], self, sequence, window[1:channels],
+                                        window[channels:2 * channels], window[2 * channels],
+                                        window[2 * channels + 1])
 
-    @property
-    def relative_symmetry(self) -> deque[float]:
-        return self._relative_symmetry
 
-    def clear(self) -> None:
-        self.time_counter = itertools.count()
-        self.time = deque(maxlen=BaseClass.QUEUE_SIZE)
-        self._output_phases = [deque(maxlen=BaseClass.QUEUE_SIZE) for _ in range(_DAQ.CHANNELS - 1)]
-        self._amplitudes = [deque(maxlen=BaseClass.QUEUE_SIZE) for _ in range(_DAQ.CHANNELS)]
-        self._symmetry = deque(maxlen=BaseClass.QUEUE_SIZE)
-        self._relative_symmetry = deque(maxlen=BaseClass.QUEUE_SIZE)
+@dataclass(frozen=True, eq=False)
+class LaserSnapshot(Snapshot):
+    pump_laser_voltage: np.ndarray
+    pump_laser_current: np.ndarray
+    probe_laser_current: np.ndarray
 
 
 class Laser(BaseClass):
     def __init__(self):
-        BaseClass.__init__(self)
-        self._pump_laser_voltage = deque(maxlen=BaseClass.QUEUE_SIZE)
-        self._pump_laser_current = deque(maxlen=BaseClass.QUEUE_SIZE)
-        self._probe_laser_current = deque(maxlen=BaseClass.QUEUE_SIZE)
-
-    @property
-    def is_empty(self) -> bool:
-        return len(self._pump_laser_voltage) == 0
+        BaseClass.__init__(self, columns=3)
 
     def append(self, laser_data: hardware.laser.Data) -> None:
-        self.time.append(next(self.time_counter) / 10)
-        self._pump_laser_voltage.append(laser_data.high_power_laser_voltage)
-        self.pump_laser_current.append(laser_data.high_power_laser_current)
-        self.probe_laser_current.append(laser_data.low_power_laser_current)
+        self._clear_if_requested()
+        self._append(next(self.time_counter) / 10, laser_data.high_power_laser_voltage,
+                     laser_data.high_power_laser_current, laser_data.low_power_laser_current)
 
-    @property
-    def pump_laser_voltage(self) -> deque[float]:
-        return self._pump_laser_voltage
+    @override
+    def _snapshot(self, window: np.ndarray, sequence: int | None) -> LaserSnapshot:
+        return LaserSnapshot(window[0], self, sequence, *window[1:])
 
-    @property
-    def pump_laser_current(self) -> deque[float]:
-        return self._pump_laser_current
 
-    @property
-    def probe_laser_current(self) -> deque[float]:
-        return self._probe_laser_current
+@dataclass(frozen=True, eq=False)
+class TecSnapshot(Snapshot):
+    set_point: np.ndarray
+    actual_value: np.ndarray
 
 
 class Tec(BaseClass):
-    def __init__(self):
-        BaseClass.__init__(self)
-        self._set_point: list[deque] = [deque(maxlen=BaseClass.QUEUE_SIZE), deque(maxlen=BaseClass.QUEUE_SIZE)]
-        self._actual_value: list[deque] = [deque(maxlen=BaseClass.QUEUE_SIZE), deque(maxlen=BaseClass.QUEUE_SIZE)]
+    CHANNELS = 2
 
-    @property
-    def is_empty(self) -> bool:
-        return len(self._set_point[0]) == 0
+    def __init__(self):
+        BaseClass.__init__(self, columns=2 * Tec.CHANNELS)
 
     def append(self, tec_data: hardware.tec.Data) -> None:
-        for channel in range(2):
-            self._set_point[channel].append(tec_data.set_point[channel])
-            self._actual_value[channel].append(tec_data.actual_temperature[channel])
-        self.time.append(next(self.time_counter))
-
-    @property
-    def set_point(self) -> list[deque[float]]:
-        return self._set_point
+        self._clear_if_requested()
+        self._append(next(self.time_counter), *tec_data.set_point[:Tec.CHANNELS],
+                     *tec_data.actual_temperature[:Tec.CHANNELS])
 
-    @property
-    def actual_value(self) -> list[deque[float]]:
-        return self._actual_value
+    @override
+    def _snapshot(self, window: np.ndarray, sequence: int | None) -> TecSnapshot:
+        return TecSnapshot(window[0], self, sequence, window[1:Tec.CHANNELS + 1],
+                           window[Tec.CHANNELS + 1:])
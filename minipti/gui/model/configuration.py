@@ -76,6 +76,7 @@ class _Save:
     valve: bool = True
     pump: bool = True
     bms: bool = True
+    live_hdf5: bool = False
 
 
 @dataclass(frozen=True)
@@ -96,11 +97,26 @@ class _OfflinePlots:
     lock_in_phases: bool = True
 
 
+@dataclass(frozen=True)
+class _Jobs:
+    max_workers: int = 1
+    use_processes: bool = False
+
+
+@dataclass(frozen=True)
+class _Profiler:
+    use: bool = True
+    interval: float = 0.01  # s
+    format: str = "speedscope"  # speedscope or collapsed
+
+
 @dataclass(frozen=True)
 class _Utilities:
     use: bool = True
     calculate: _Calculation = _Calculation()
     plot: _OfflinePlots = _OfflinePlots()
+    jobs: _Jobs = _Jobs()
+    profiler: _Profiler = _Profiler()
 
 
 @dataclass(frozen=True)
@@ -115,6 +131,13 @@ class _Plots:
     measurement: _Plot = _Plot()
 
 
+@dataclass(frozen=True)
+class _History:
+    chunk_size: int = 4096  # Rows
+    resident_chunks: int = 64  # Older chunks are spilled to a memory mapped file
+    points: int = 2000  # Maximal points of a history plot
+
+
 @dataclass(frozen=True)
 class _Battery:
     use: bool = True
@@ -133,6 +156,45 @@ class _Pump:
     use: bool = True
 
 
+@dataclass(frozen=True)
+class _Load:
+    use: bool = True
+    interval: float = 2  # s
+    log_interval: float = 60  # s
+
+
+@dataclass(frozen=True)
+class ComputeProfile:
+    name: str = "Full"
+    plot_period: float = 0  # s, minimal time between two updates of a live plot
+    characterisation_interval: float = 0  # s, minimal time between two live characterisations
+    csv_batch_rows: int = 1  # Rows of a CSV file written at once
+    save_raw_data: bool = True  # If disabled, no raw data is saved, even if requested
+
+
+@dataclass(frozen=True)
+class _Power:
+    use: bool = True
+    saving_percentage: float = 50
+    saving_minutes: float = 120
+    critical_percentage: float = 20
+    hysteresis: float = 5  # %
+    full: ComputeProfile = ComputeProfile()
+    saving: ComputeProfile = ComputeProfile("Saving", plot_period=2, characterisation_interval=300,
+                                            csv_batch_rows=10)
+    critical: ComputeProfile = ComputeProfile("Critical", plot_period=10, characterisation_interval=1800,
+                                              csv_batch_rows=60, save_raw_data=False)
+
+
+@dataclass(frozen=True)
+class _Realtime:
+    use: bool = False  # Real-time scheduling of the motherboard receive and processing thread
+    cpus: list[int] = dataclasses.field(default_factory=list)  # Empty for all CPUs
+    fifo_priority: int = 10  # 1 - 99, 0 to not use SCHED_FIFO
+    nice: int = -10  # Used if SCHED_FIFO is not permitted
+    lock_memory: bool = False  # Also locks files mapped at the start, see hardware.realtime
+
+
 @dataclass(frozen=True)
 class _GUI:
     window_title: str = "MiniPTI"
@@ -151,6 +213,10 @@ class _GUI:
     plots: _Plots = _Plots()
     on_run: _OnRun = _OnRun()
     live_plot_size: int = 1000
+    history: _History = _History()
+    load: _Load = _Load()
+    power: _Power = _Power()
+    realtime: _Realtime = _Realtime()
 
 
 def _parse_configuration() -> _GUI:
@@ -0,0 +1,156 @@
+"""
+Whole session history of the live buffers.
+
+The values are kept column wise in float32 chunks of a fixed number of rows, the time in float64.
+Full chunks beyond a number of resident ones are spilled to a memory mapped temporary file. Every
+chunk holds the min and max of its blocks and of itself in memory, so a time window of any length is
+reduced to a bounded number of points without touching spilled data.
+"""
+import math
+import tempfile
+from typing import Final
+
+import numpy as np
+
+
+class History:
+    """
+    Only one thread may append. Readers need no lock, because rows are never changed after the row
+    count has been increased and chunks are only replaced by a mapped copy of themselves.
+    """
+    BLOCK_SIZE: Final = 64
+
+    def __init__(self, columns: int, chunk_size: int = 4096, resident_chunks: int = 64):
+        self.columns = columns
+        self.chunk_size = chunk_size - chunk_size % History.BLOCK_SIZE
+        self.resident_chunks = resident_chunks
+        self.blocks_per_chunk = self.chunk_size // History.BLOCK_SIZE
+        self.rows = 0
+        self._values: list[np.ndarray] = []
+        self._times: list[np.ndarray] = []
+        self._block_minima: list[np.ndarray] = []
+        self._block_maxima: list[np.ndarray] = []
+        self._chunk_minima: list[np.ndarray] = []
+        self._chunk_maxima: list[np.ndarray] = []
+        self._spilled = 0
+        self._spill_file = None
+
+    def __repr__(self) -> str:
+        class_name = self.__class__.__name__
+        return f"{class_name}(columns={self.columns}, rows={self.rows}, spilled_chunks={self._spilled})"
+
+    def __len__(self) -> int:
+        return self.rows
+
+    @property
+    def spilled_chunks(self) -> int:
+        return self._spilled
+
+    def append(self, time: float, values: np.ndarray) -> None:
+        chunk, row = divmod(self.rows, self.chunk_size)
+        if row == 0:
+            self._new_chunk()
+        block = row // History.BLOCK_SIZE
+        self._values[chunk][:, row] = values
+        self._times[chunk][row] = time
+        stored = self._values[chunk][:, row]
+        # NaN rows (e.g. the mean of the PTI signal for other average periods) are ignored by the envelope.
+        np.fmin(self._block_minima[chunk][:, block], stored, out=self._block_minima[chunk][:, block])
+        np.fmax(self._block_maxima[chunk][:, block], stored, out=self._block_maxima[chunk][:, block])
+        np.fmin(self._chunk_minima[chunk], stored, out=self._chunk_minima[chunk])
+        np.fmax(self._chunk_maxima[chunk], stored, out=self._chunk_maxima[chunk])
+        self.rows += 1
+        if row == self.chunk_size - 1 and chunk - self._spilled >= self.resident_chunks:
+            self._spill()
+
+    def _new_chunk(self) -> None:
+        self._values.append(np.full((self.columns, self.chunk_size), np.nan, dtype=np.float32))
+        self._times.append(np.full(self.chunk_size, np.nan))
+        self._block_minima.append(np.full((self.columns, self.blocks_per_chunk), np.inf, dtype=np.float32))
+        self._block_maxima.append(np.full((self.columns, self.blocks_per_chunk), -np.inf, dtype=np.float32))
+        self._chunk_minima.append(np.full(self.columns, np.inf, dtype=np.float32))
+        self._chunk_maxima.append(np.full(self.columns, -np.inf, dtype=np.float32))
+
+    def _spill(self) -> None:
+        if self._spill_file is None:
+            self._spill_file = tempfile.TemporaryFile(prefix="minipti_history_")
+        chunk = self._values[self._spilled]
+        offset = self._spilled * chunk.nbytes
+        self._spill_file.seek(offset)
+        self._spill_file.write(chunk.tobytes())
+        self._spill_file.flush()
+        self._values[self._spilled] = np.memmap(self._spill_file, dtype=np.float32, mode="r", offset=offset,
+                                                shape=chunk.shape)
+        self._spilled += 1
+
+    def close(self) -> None:
+        if self._spill_file is not None:
+            self._spill_file.close()
+
+    def _first_row(self, time: float, rows: int) -> int:
+        chunks = -(-rows // self.chunk_size)
+        first_times = np.fromiter((self._times[chunk][0] for chunk in range(chunks)), float, count=chunks)
+        chunk = max(int(np.searchsorted(first_times, time, side="right")) - 1, 0)
+        filled = min(rows - chunk * self.chunk_size, self.chunk_size)
+        return chunk * self.chunk_size + int(np.searchsorted(self._times[chunk][:filled], time))
+
+    def window(self, start: float, end: float, points: int) -> np.ndarray:
+        """
+        The rows with start <= time <= end, with the time as first column. If there are more than
+        points rows, the min and max of groups of blocks or chunks are returned at the first and last
+        time of the group instead, which are at most points rows.
+        """
+        rows = self.rows
+        if rows == 0:
+            return np.empty((self.columns + 1, 0))
+        first = self._first_row(start, rows)
+        last = self._first_row(np.nextafter(end, np.inf), rows)
+        if last - first <= points:
+            return self._raw(first, last)
+        if 2 * (last - first) // History.BLOCK_SIZE <= points:
+            return self._envelope(first, last, History.BLOCK_SIZE, self._block_minima, self._block_maxima, points)
+        return self._envelope(first, last, self.chunk_size, self._chunk_minima, self._chunk_maxima, points)
+
+    def _raw(self, first: int, last: int) -> np.ndarray:
+        window = np.empty((self.columns + 1, last - first))
+        row = first
+        while row < last:
+            chunk, offset = divmod(row, self.chunk_size)
+            length = min(last - row, self.chunk_size - offset)
+            window[0, row - first:row - first + length] = self._times[chunk][offset:offset + length]
+            window[1:, row - first:row - first + length] = self._values[chunk][:, offset:offset + length]
+            row += length
+        return window
+
+    def _envelope(self, first: int, last: int, size: int, minima: list[np.ndarray], maxima: list[np.ndarray],
+                  points: int) -> np.ndarray:
+        """
+        Min and max of the units (blocks or chunks) of size rows which intersect [first, last).
+        """
+        units = range(first // size, (last - 1) // size + 1)
+        if size == self.chunk_size:
+            unit_minima = np.column_stack([minima[unit] for unit in units])
+            unit_maxima = np.column_stack([maxima[unit] for unit in units])
+        else:
+            unit_minima = np.column_stack([minima[unit // self.blocks_per_chunk][:, unit % self.blocks_per_chunk]
+                                           for unit in units])
+            unit_maxima = np.column_stack([maxima[unit // self.blocks_per_chunk][:, unit % self.blocks_per_chunk]
+                                           for unit in units])
+        first_times = np.array([self._time(unit * size) for unit in units])
+        last_times = np.array([self._time(min((unit + 1) * size, last) - 1) for unit in units])
+        group = max(math.ceil(2 * len(units) / points), 1)
+        starts = np.arange(0, len(units), group)
+        window = np.empty((self.columns + 1, 2 * len(starts)))
+        window[0, 0::2] = first_times[starts]
+        window[0, 1::2] = last_times[np.minimum(starts + group, len(units)) - 1]
+        window[1:, 0::2] = np.fmin.reduceat(unit_minima, starts, axis=1)
+        window[1:, 1::2] = np.fmax.reduceat(unit_maxima, starts, axis=1)
+        # Groups of only NaN rows keep the initial inf and -inf, they are gaps as in the raw rows.
+        empty = window[1:, 0::2] > window[1:, 1::2]
+        window[1:, 0::2][empty] = np.nan
+        window[1:, 1::2][empty] = np.nan
+        return window
+
+    def _time(self, row: int) -> float:
+        chunk, offset = divmod(row, self.chunk_size)
+        return self._times[chunk][offset]
@@ -0,0 +1,200 @@
+"""
+Managed execution of offline calculations.
+"""
+import concurrent.futures
+import logging
+import multiprocessing
+import multiprocessing.connection
+import threading
+import time
+from collections.abc import Callable, Generator
+from typing import Final
+
+from minipti.gui.model import signals
+
+
+class Job:
+    """
+    A queued offline calculation.
+
+    The task is either a plain callable or returns a generator, which yields the fraction of already
+    processed data. A job can only be cancelled between two of these steps, hence plain tasks run
+    until they are finished once they have been started.
+    The process task is a picklable variant of the task, which is used if the executor is backed
+    by processes. Its progress is sent back from the worker process, which is terminated if the
+    job is cancelled.
+    """
+    def __init__(self, name: str, task: Callable[[], Generator[float, None, None] | None],
+                 process_task: Callable[[], Generator[float, None, None] | None] | None = None,
+                 on_finished: Callable[[], None] | None = None):
+        self.name = name
+        self.task = task
+        self.process_task = process_task
+        self.on_finished = on_finished
+        self.progress: float = 0
+        self.eta: float | None = None
+        self._cancel = threading.Event()
+        self._future: concurrent.futures.Future | None = None
+
+    def __repr__(self) -> str:
+        class_name = self.__class__.__name__
+        return f"{class_name}(name={self.name}, progress={self.progress}, eta={self.eta}," \
+               f" cancelled={self.cancelled})"
+
+    @property
+    def cancelled(self) -> bool:
+        return self._cancel.is_set()
+
+    @property
+    def done(self) -> bool:
+        return self._future is not None and self._future.done()
+
+    def cancel(self) -> None:
+        self._cancel.set()
+        if self._future is not None:
+            self._future.cancel()
+
+    def wait(self, timeout: float | None = None) -> None:
+        if self._future is not None:
+            concurrent.futures.wait([self._future], timeout=timeout)
+
+
+class Executor:
+    """
+    Runs jobs from a queue with at most max_workers of them at once.
+
+    The progress of all active jobs is reported as their mean through the progress bar signals,
+    the ETA as the one of the slowest job.
+    If use_processes is set, jobs with a process task are calculated in spawned processes, so they
+    neither share the GIL with the GUI nor inherit its threads. Every such job gets its own process,
+    started by the thread running the job, so there are still at most max_workers of them.
+    """
+    POLL_INTERVAL: Final = 0.2  # s, how long a cancelled process job may still run
+
+    def __init__(self, max_workers: int = 1, use_processes: bool = False):
+        self._threads = concurrent.futures.ThreadPoolExecutor(max_workers=max_workers,
+                                                              thread_name_prefix="Calculation")
+        self._processes = multiprocessing.get_context("spawn") if use_processes else None
+        self._jobs: list[Job] = []
+        self._lock = threading.Lock()
+        self._percentage = -1
+
+    @property
+    def jobs(self) -> list[Job]:
+        with self._lock:
+            return list(self._jobs)
+
+    def submit(self, job: Job) -> Job:
+        with self._lock:
+            self._jobs.append(job)
+        logging.info("Queued %s", job.name)
+        job._future = self._threads.submit(self._run, job)
+        job._future.add_done_callback(lambda future: self._finish(job, future))
+        return job
+
+    def cancel_all(self) -> None:
+        for job in self.jobs:
+            job.cancel()
+
+    def shutdown(self) -> None:
+        self.cancel_all()
+        self._threads.shutdown(wait=False, cancel_futures=True)
+
+    def _run(self, job: Job) -> None:
+        if job.cancelled:
+            return
+        logging.info("Started %s", job.name)
+        start = time.perf_counter()
+        self._update_progress()
+        if self._processes is not None and job.process_task is not None:
+            steps = self._process_steps(job)
+        else:
+            steps = job.task()
+        if steps is not None:
+            for progress in steps:
+                if job.cancelled:
+                    steps.close()
+                    logging.info("Cancelled %s at %.1f %%", job.name, job.progress * 100)
+                    return
+                job.progress = progress
+                if progress > 0:
+                    job.eta = (time.perf_counter() - start) * (1 - progress) / progress
+                self._update_progress()
+        job.progress = 1
+        job.eta = 0
+        logging.info("Finished %s after %.1f s", job.name, time.perf_counter() - start)
+        if job.on_finished is not None:
+            job.on_finished()
+
+    def _process_steps(self, job: Job) -> Generator[float, None, None]:
+        """
+        Runs the process task in a new process and yields the progress it sends. The last progress
+        is repeated every POLL_INTERVAL, so a cancellation is noticed even if the task does not
+        report any. Closing the generator terminates a still running process.
+        """
+        connection, child_connection = self._processes.Pipe(duplex=False)
+        worker = self._processes.Process(target=_run_process_task, args=(job.process_task, child_connection),
+                                         name=job.name, daemon=True)
+        worker.start()
+        child_connection.close()
+        progress = 0.
+        try:
+            while True:
+                if connection.poll(Executor.POLL_INTERVAL):
+                    try:
+                        message = connection.recv()
+                    except EOFError:
+                        raise RuntimeError(f"Process exited with {worker.exitcode}") from None
+                    if message is None:
+                        return
+                    if isinstance(message, BaseException):
+                        raise message
+                    progress = message
+                yield progress
+        finally:
+            if worker.is_alive() and job.cancelled:
+                worker.terminate()
+            worker.join()
+            connection.close()
+
+    def _finish(self, job: Job, future: concurrent.futures.Future) -> None:
+        with self._lock:
+            self._jobs.remove(job)
+        if not future.cancelled() and future.exception() is not None:
+            logging.error("%s failed: %s", job.name, future.exception())
+        self._update_progress()
+
+    def _update_progress(self) -> None:
+        jobs = self.jobs
+        if not jobs:
+            self._percentage = -1
+            signals.GENERAL_PURPORSE.progess_bar_stop.emit()
+            return
+        if self._percentage == -1:
+            signals.GENERAL_PURPORSE.progess_bar_start.emit()
+        percentage = int(sum(job.progress for job in jobs) / len(jobs) * 100)
+        if percentage != self._percentage:  # Emitting every step would flood the event loop
+            self._percentage = percentage
+            signals.GENERAL_PURPORSE.progess_bar.emit(percentage)
+            etas: list[float] = [job.eta for job in jobs if job.eta is not None]
+            if etas:
+                signals.GENERAL_PURPORSE.progess_bar_eta.emit(max(etas))
+
+
+
+def _run_process_task(task: Callable[[], Generator[float, None, None] | None],
+                      connection: multiprocessing.connection.Connection) -> None:
+    """
+    Runs in the worker process and sends the progress of the task, None if it is finished or the
+    exception it raised.
+    """
+    try:
+        steps = task()
+        if steps is not None:
+            for progress in steps:
+                connection.send(progress)
+        connection.send(None)
+    except Exception as error:
+        connection.send(error)
+    finally:
+        connection.close()
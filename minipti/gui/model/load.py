@@ -0,0 +1,167 @@
+"""
+CPU time and loop latency of every thread of the application.
+
+The CPU time of the threads is read on Linux from /proc/self/task, on other systems only the
+latency is available. Loops report the duration of an iteration by running it in
+SAMPLER.iteration(), the time waiting for data belongs outside of it. Threads with the same name,
+e.g. the incoming data of several devices, are accounted together.
+"""
+import contextlib
+import logging
+import os
+import threading
+import time
+from dataclasses import dataclass
+from typing import Final, Iterator
+
+from minipti.gui.model import signals
+
+
+@dataclass(frozen=True)
+class ThreadLoad:
+    name: str
+    cpu: float | None  # Fraction of one core, None without procfs
+    latency: float | None  # Mean iteration time in s, None for uninstrumented threads
+    max_latency: float | None  # s
+    iterations: int
+
+    def __str__(self) -> str:
+        cpu = "n/a" if self.cpu is None else f"{self.cpu:.0%}"
+        if self.latency is None:
+            return f"{self.name}: CPU {cpu}"
+        return f"{self.name}: CPU {cpu}, {self.iterations} iterations, latency {self.latency * 1e3:.1f} ms" \
+               f" (max {self.max_latency * 1e3:.1f} ms)"
+
+
+@dataclass
+class _Latency:
+    iterations: int = 0
+    total: float = 0  # s
+    maximum: float = 0  # s
+
+    def add(self, duration: float) -> None:
+        self.iterations += 1
+        self.total += duration
+        self.maximum = max(self.maximum, duration)
+
+
+class _Window:
+    """
+    Load since the last sample of the window.
+    """
+    def __init__(self, cpu_times: dict[int, float]):
+        self.start = time.monotonic()
+        self.cpu_times = cpu_times
+        self.latencies: dict[str, _Latency] = {}
+
+    def loads(self, cpu_times: dict[int, float], names: dict[int, str]) -> list[ThreadLoad]:
+        interval = max(time.monotonic() - self.start, 1e-9)
+        cpu: dict[str, float] = {}
+        for tid, cpu_time in cpu_times.items():
+            name = names[tid]
+            cpu[name] = cpu.get(name, 0) + (cpu_time - self.cpu_times.get(tid, 0)) / interval
+        loads = []
+        for name in cpu.keys() | self.latencies.keys():
+            latency = self.latencies.get(name)
+            if latency is None or not latency.iterations:
+                loads.append(ThreadLoad(name, cpu.get(name), None, None, 0))
+            else:
+                loads.append(ThreadLoad(name, cpu.get(name), latency.total / latency.iterations, latency.maximum,
+                                        latency.iterations))
+        return sorted(loads, key=lambda load: (load.cpu or 0, load.latency or 0), reverse=True)
+
+
+class Sampler:
+    SUMMARY_THREADS: Final = 3
+
+    def __init__(self):
+        self._lock = threading.Lock()
+        self._clock_ticks = os.sysconf("SC_CLK_TCK") if hasattr(os, "sysconf") else 100
+        self.available = os.path.isdir("/proc/self/task")
+        self._comm: dict[int, str] = {}
+        cpu_times = self._cpu_times()
+        self._live = _Window(cpu_times)
+        self._log = _Window(cpu_times)
+
+    @contextlib.contextmanager
+    def iteration(self) -> Iterator[None]:
+        start = time.perf_counter()
+        try:
+            yield
+        finally:
+            self.record(threading.current_thread().name, time.perf_counter() - start)
+
+    def record(self, name: str, duration: float) -> None:
+        with self._lock:
+            for window in self._live, self._log:
+                window.latencies.setdefault(name, _Latency()).add(duration)
+
+    def _cpu_times(self) -> dict[int, float]:
+        """
+        CPU time (user and system) of every thread in s.
+        """
+        if not self.available:
+            return {}
+        cpu_times = {}
+        for task in os.listdir("/proc/self/task"):
+            try:
+                with open(f"/proc/self/task/{task}/stat") as stat:
+                    content = stat.read()
+            except OSError:  # The thread has already terminated
+                continue
+            # The command may contain spaces and parentheses, the fields behind it are fixed.
+            comm_end = content.rindex(")")
+            fields = content[comm_end + 2:].split()
+            tid = int(task)
+            self._comm[tid] = content[content.index("(") + 1:comm_end]
+            cpu_times[tid] = (int(fields[11]) + int(fields[12])) / self._clock_ticks
+        return cpu_times
+
+    def _names(self, tids) -> dict[int, str]:
+        names = {thread.native_id: thread.name for thread in threading.enumerate()}
+        names[threading.main_thread().native_id] = "GUI"
+        return {tid: names.get(tid, self._comm.get(tid, str(tid))) for tid in tids}
+
+    def _sample(self, attribute: str) -> list[ThreadLoad]:
+        cpu_times = self._cpu_times()
+        with self._lock:
+            loads = getattr(self, attribute).loads(cpu_times, self._names(cpu_times))
+            setattr(self, attribute, _Window(cpu_times))
+        return loads
+
+    def sample(self) -> list[ThreadLoad]:
+        """
+        Load of every thread since the last sample.
+        """
+        return self._sample("_live")
+
+    def sample_log(self) -> list[ThreadLoad]:
+        """
+        Load of every thread since the last logged sample, independent of sample.
+        """
+        return self._sample("_log")
+
+    def run(self, interval: float, log_interval: float) -> None:
+        last_log = time.monotonic()
+        while True:
+            time.sleep(interval)
+            signals.GENERAL_PURPORSE.thread_load.emit(self.sample())
+            if time.monotonic() - last_log >= log_interval:
+                last_log = time.monotonic()
+                logging.info("Thread load: %s", "; ".join(str(load) for load in self.sample_log()))
+
+
+def summary(loads: list[ThreadLoad], threads: int = Sampler.SUMMARY_THREADS) -> str:
+    """
+    The most loaded threads and the total CPU of all threads in one line.
+    """
+    measured = [load for load in loads if load.cpu is not None]
+    if not measured:
+        slowest = sorted((load for load in loads if load.latency is not None), key=lambda load: load.latency,
+                         reverse=True)[:threads]
+        return ", ".join(f"{load.name} {load.latency * 1e3:.0f} ms" for load in slowest)
+    total = sum(load.cpu for load in measured)
+    return f"CPU {total:.0%}: " + ", ".join(f"{load.name} {load.cpu:.0%}" for load in measured[:threads])
+
+
+SAMPLER: Final = Sampler()
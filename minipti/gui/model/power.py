@@ -0,0 +1,59 @@
+"""
+Compute profile of the live pipeline, chosen by the state of the battery.
+
+On external power or while charging, the full profile is used. On battery, the saving profile is
+used below a charge or remaining time and the critical profile below a lower charge. A profile is
+only left for a less saving one if the charge is the hysteresis above its threshold (the remaining
+time the hysteresis in %), so a fluctuating charge does not toggle the profile. The consumers read
+the current profile whenever they need it.
+"""
+import logging
+from typing import Final
+
+from minipti import algorithm, hardware
+from minipti.gui.model import configuration
+
+
+class Manager:
+    def __init__(self, settings: configuration._Power = configuration.GUI.power):
+        self.settings = settings
+        self._profile = settings.full
+
+    @property
+    def profile(self) -> configuration.ComputeProfile:
+        return self._profile
+
+    def _level(self, profile: configuration.ComputeProfile) -> int:
+        return (self.settings.full, self.settings.saving, self.settings.critical).index(profile)
+
+    def select(self, bms_data: hardware.motherboard.BMSData) -> configuration.ComputeProfile:
+        if bms_data.external_dc_power or bms_data.charging:
+            return self.settings.full
+        percentage = bms_data.battery_percentage
+        current = self._level(self._profile)
+        # Thresholds are raised by the hysteresis for returning to a less saving profile.
+        critical_threshold = self.settings.critical_percentage
+        saving_threshold = self.settings.saving_percentage
+        saving_minutes = self.settings.saving_minutes
+        if current >= 2:
+            critical_threshold += self.settings.hysteresis
+        if current >= 1:
+            saving_threshold += self.settings.hysteresis
+            saving_minutes *= 1 + self.settings.hysteresis / 100
+        if percentage < critical_threshold:
+            return self.settings.critical
+        if percentage < saving_threshold or bms_data.minutes_left < saving_minutes:
+            return self.settings.saving
+        return self.settings.full
+
+    def update(self, bms_data: hardware.motherboard.BMSData) -> None:
+        profile = self.select(bms_data)
+        if profile == self._profile:
+            return
+        logging.info("Switched from %s to %s compute profile at %d %% battery, %d min left", self._profile.name,
+                     profile.name, bms_data.battery_percentage, bms_data.minutes_left)
+        self._profile = profile
+        algorithm._utilities.CSV_ROWS.batch_rows = profile.csv_batch_rows
+
+
+MANAGER: Final = Manager()
@@ -1,9 +1,12 @@
 import csv
+import functools
 import logging
 import os
 import threading
+import time
 import typing
 from collections import deque
+from collections.abc import Generator
 from datetime import datetime
 
 import numpy as np
@@ -16,6 +19,9 @@ from minipti import algorithm
 from minipti.gui.model import buffer, serial_devices
 from minipti.gui.model import configuration
 from minipti.gui.model import general_purpose
+from minipti.gui.model import jobs
+from minipti.gui.model import load
+from minipti.gui.model import power
 from minipti.gui.model import signals
 
 
@@ -42,7 +48,6 @@ class Calculation:
         self.pti.inversion.interferometer = self.interferometer
         self.interferometer_characterization = algorithm.interferometry.Characterization(self.interferometer)
         signals.GENERAL_PURPORSE.destination_folder_changed.connect(self._update_destination_folder)
-        signals.DAQ.samples_changed.connect(self._update_decimation_average_period)
         signals.CALCULATION.settings_path_changed.connect(self.update_settings_path)
 
     def update_settings_path(self, settings_path: str) -> None:
@@ -53,121 +58,265 @@ class Calculation:
         self.pti.inversion.destination_folder = folder
         self.pti.decimation.destination_folder = folder
         self.interferometer.destination_folder = folder
-
-    def _update_decimation_average_period(self, samples: int) -> None:
-        self.pti.decimation.average_period = samples
+        algorithm.backend.SHADOW.destination_folder = folder
 
 
 class LiveCalculation(Calculation):
     MEAN_INTERVAL = 60  # s
+    SETPOINT_DECIMALS = 2  # °C, resolution of the TEC setpoint written by the working point control
 
     def __init__(self):
         Calculation.__init__(self)
         self.current_time = 0
-        self.dc_signals = []
         self.interferometer_buffer = buffer.Interferometer()
         self.pti_buffer = buffer.PTI()
         self.characterisation_buffer = buffer.Characterisation()
         self.pti_signal_mean_queue = deque(maxlen=LiveCalculation.MEAN_INTERVAL)
         self.new_directory = True
+        self.working_point: algorithm.control.WorkingPointController | None = None
+        self.save_raw_data = False
+        self._last_characterisation = -np.inf
         signals.DAQ.clear.connect(self._clear_buffers)
 
     def update_new_directory(self) -> None:
         self.new_directory = True
 
     def _clear_buffers(self) -> None:
-        self.interferometer_buffer.clear()
-        self.pti_buffer.clear()
-        self.characterisation_buffer.clear()
+        self.interferometer_buffer.request_clear()
+        self.pti_buffer.request_clear()
+        self.characterisation_buffer.request_clear()
 
     def process_daq_data(self) -> None:
         now = datetime.now()
         date = str(now.strftime(r"%Y%m%d"))
         time = str(now.strftime(r"%H%M%S"))
         minipti.path_prefix = f"{date}_{time}"
+        if configuration.GUI.save.live_hdf5:
+            self._open_live_file()
         threading.Thread(target=self._run_calculation, name="PTI Inversion", daemon=True).start()
         threading.Thread(target=self._run_characterization, name="Characterisation", daemon=True).start()
 
     def set_raw_data_saving(self, save_raw_data: bool) -> None:
-        self.pti.decimation.save_raw_data = save_raw_data
+        self.save_raw_data = save_raw_data
 
     def set_common_mode_noise_reduction(self, common_mode_noise_reduction: bool) -> None:
+        if common_mode_noise_reduction and not self.pti.decimation.use_common_mode_noise_reduction:
+            self.pti.decimation.common_mode.reset()
         self.pti.decimation.use_common_mode_noise_reduction = common_mode_noise_reduction
 
+    def _open_live_file(self) -> None:
+        live_file = algorithm.swmr.LiveFile(f"{self.pti.decimation.destination_folder}/"
+                                            f"{minipti.path_prefix}_Live.hdf5",
+                                            self.pti.decimation.sample_rate, self.pti.decimation.ref_period)
+        logging.info("Writing live data into %s", live_file.file_path)
+        self._set_live_file(live_file)
+
+    def _close_live_file(self) -> None:
+        if self.pti.decimation.live_file is not None:
+            self.pti.decimation.live_file.close()
+            self._set_live_file(None)
+
+    def _set_live_file(self, live_file: algorithm.swmr.LiveFile | None) -> None:
+        self.pti.decimation.live_file = live_file
+        self.pti.inversion.live_file = live_file
+        self.interferometer.live_file = live_file
+        self.interferometer_characterization.live_file = live_file
+
     def _run_calculation(self):
         self._init_calculation()
         while serial_devices.TOOLS.daq.running:
-            self._decimation()
-            self._interferometer_calculation()
-            self._characterisation()
-            self._pti_inversion()
+            self._receive_package()
+            with load.SAMPLER.iteration():
+                self.pti.decimation.save_raw_data = self.save_raw_data and power.MANAGER.profile.save_raw_data
+                self._decimation()
+                if self.working_point is not None:
+                    self._control_working_point()
+                self._interferometer_calculation()
+                self._characterisation()
+                self._pti_inversion()
+        self._close_live_file()
+        algorithm.backend.SHADOW.join()
+        algorithm._utilities.CSV_ROWS.flush()
 
     def _run_characterization(self) -> None:
         while serial_devices.TOOLS.daq.running:
-            self.interferometer_characterization.characterise(live=True)
+            if not self.interferometer_characterization.characterise(live=True):
+                continue
             self.characterisation_buffer.append(self.interferometer_characterization)
-            signals.DAQ.characterization.emit(self.characterisation_buffer)
+            signals.DAQ.characterization.emit(self.characterisation_buffer.snapshot())
             signals.CALCULATION.settings_interferometer.emit(self.interferometer.characteristic_parameter)
+            if self.working_point is not None:
+                self.working_point.update_parameters(self.interferometer.characteristic_parameter)
+        self.interferometer_characterization.close()
 
     def _init_calculation(self) -> None:
+        # The acquisition of the DAQ firmware flows into the decimation and the stored raw data.
+        self.pti.decimation.configure_acquisition(serial_devices.TOOLS.daq.sample_rate,
+                                                  serial_devices.TOOLS.daq.ref_period)
         self.pti.inversion.init_header = True
         self.pti.decimation.init_header = True
         self.interferometer.init_online = True
         self.interferometer_characterization.init_online = True
         self.interferometer.load_settings()
         self.pti.inversion.load_response_phase()
+        if algorithm.pti.ResponsePhaseTracker.CONFIGURATION.use:
+            self.pti.inversion.response_phase_tracker = algorithm.pti.ResponsePhaseTracker()
+            self.pti.inversion.response_phase_version = 0
+        if algorithm.control.CONFIGURATION.use:
+            self.working_point = algorithm.control.WorkingPointController(
+                self.interferometer.characteristic_parameter,
+                self._working_point_actuator
+            )
+
+    @property
+    def _working_point_actuator(self) -> float:
+        if algorithm.control.CONFIGURATION.actuator == "tec":
+            return serial_devices.TOOLS.tec[serial_devices.Tec.PROBE_LASER].setpoint_temperature
+        return serial_devices.TOOLS.probe_laser.current_bits_probe_laser
+
+    @_working_point_actuator.setter
+    def _working_point_actuator(self, value: float) -> None:
+        # Commands are only written if the actuator value changes, not on every cycle.
+        if algorithm.control.CONFIGURATION.actuator == "tec":
+            tec = serial_devices.TOOLS.tec[serial_devices.Tec.PROBE_LASER]
+            value = round(value, LiveCalculation.SETPOINT_DECIMALS)
+            if value != round(tec.setpoint_temperature, LiveCalculation.SETPOINT_DECIMALS):
+                tec.setpoint_temperature = value
+        elif round(value) != serial_devices.TOOLS.probe_laser.current_bits_probe_laser:
+            serial_devices.TOOLS.probe_laser.current_bits_probe_laser = round(value)
+
+    def _control_working_point(self) -> None:
+        # Uses the closed form phase estimate, so the actuator is set before the slower phase calculation.
+        self._working_point_actuator = self.working_point.step(self.pti.decimation.dc_signals,
+                                                               self.pti.decimation.period)
+
+    def _receive_package(self) -> None:
+        # Every package is a new array, which is only referenced by the calculation.
+        self.pti.decimation.raw_data.ref = serial_devices.TOOLS.daq.ref_signal
+        self.pti.decimation.raw_data.dc = serial_devices.TOOLS.daq.dc_coupled
+        self.pti.decimation.raw_data.ac = serial_devices.TOOLS.daq.ac_coupled
 
     def _decimation(self) -> None:
-        self.pti.decimation.raw_data.ref = serial_devices.TOOLS.daq.ref_signal.copy()
-        self.pti.decimation.raw_data.dc = serial_devices.TOOLS.daq.dc_coupled.copy()
-        self.pti.decimation.raw_data.ac = serial_devices.TOOLS.daq.ac_coupled.copy()
         self.pti.decimation.run(live=True)
 
     def _interferometer_calculation(self) -> None:
         self.interferometer.intensities = self.pti.decimation.dc_signals
         self.interferometer.run(live=True)
         self.interferometer_buffer.append(self.interferometer)
-        signals.DAQ.interferometry.emit(self.interferometer_buffer)
+        signals.DAQ.interferometry.emit(self.interferometer_buffer.snapshot())
 
     def _pti_inversion(self) -> None:
+        response_phase_version = self.pti.inversion.response_phase_version
         self.pti.inversion.run(live=True)
-        self.pti_buffer.append(self.pti, self.pti.decimation.average_period)
-        signals.DAQ.inversion.emit(self.pti_buffer)
+        if self.pti.inversion.response_phase_version != response_phase_version:
+            signals.CALCULATION.response_phases.emit(self.pti.inversion.response_phases)
+        self.pti_buffer.append(self.pti, self.pti.decimation.period)
+        signals.DAQ.inversion.emit(self.pti_buffer.snapshot())
 
     def _characterisation(self) -> None:
-        self.interferometer_characterization.add_phase(self.interferometer.phase)
-        self.dc_signals.append(self.pti.decimation.dc_signals.copy())
-        if self.interferometer_characterization.enough_values:
-            self.interferometer_characterization.interferometer.intensities = np.array(self.dc_signals)
-            self.dc_signals = []
-            self.interferometer_characterization.event.set()
+        self.interferometer_characterization.add_phase(self.interferometer.phase, self.pti.decimation.dc_signals)
+        # The reservoir keeps sampling while a saving profile defers the characterisation.
+        if time.monotonic() - self._last_characterisation < power.MANAGER.profile.characterisation_interval:
+            return
+        if self.interferometer_characterization.take_samples():
+            self._last_characterisation = time.monotonic()
 
 
 class OfflineCalculation(Calculation):
     def __init__(self):
         Calculation.__init__(self)
-
-    def calculate_characterisation(self, dc_file_path: str) -> None:
-        self.interferometer_characterization.characterise(file_path=dc_file_path)
-        signals.CALCULATION.settings_interferometer.emit(self.interferometer.characteristic_parameter)
-
-    def calculate_decimation(self, decimation_path: str) -> None:
-        self.pti.decimation.file_path = decimation_path
-        logging.info("Starting Decimation of Raw Data")
-        threading.Thread(target=self.pti.decimation.run, name="Decimation Thread").start()
+        self.jobs = jobs.Executor(configuration.GUI.utilities.jobs.max_workers,
+                                  configuration.GUI.utilities.jobs.use_processes)
 
     def calculate_response_phases(self, decimation_path: str) -> None:
         self.pti.inversion.calculate_response_phase(decimation_path)
         signals.CALCULATION.response_phases.emit(self.pti.inversion.response_phases)
 
-    def calculate_interferometry(self, interferometry_path: str) -> None:
-        self.interferometer.load_settings()
-        self.interferometer.run(file_path=interferometry_path)
-
-    def calculate_inversion(self, inversion_path: str) -> None:
-        self.interferometer.load_settings()
-        self.pti.inversion.load_response_phase()
-        self.pti.inversion.run(file_path=inversion_path)
+    def submit_decimation(self, decimation_path: str) -> jobs.Job:
+        # The prefix of the submission is used, a process would only know the default one.
+        path_prefix = minipti.path_prefix
+        task = functools.partial(decimate, decimation_path, self.interferometer.destination_folder, path_prefix)
+        return self.jobs.submit(jobs.Job(
+            "Decimation",
+            task=task,
+            process_task=task,
+            on_finished=functools.partial(process_dc_data,
+                                          f"{self.interferometer.destination_folder}/{path_prefix}_Decimation.csv")
+        ))
+
+    def submit_interferometry(self, interferometry_path: str) -> jobs.Job:
+        task = functools.partial(calculate_interferometry, interferometry_path, self.interferometer.settings_path,
+                                 self.interferometer.destination_folder)
+        return self.jobs.submit(jobs.Job(
+            "Interferometry",
+            task=task,
+            process_task=task,
+            on_finished=functools.partial(process_interferometric_phase_data,
+                                          f"{self.interferometer.destination_folder}/Offline_Interferometer.csv")
+        ))
+
+    def submit_inversion(self, inversion_path: str) -> jobs.Job:
+        task = functools.partial(calculate_inversion, inversion_path, self.interferometer.settings_path,
+                                 self.interferometer.destination_folder)
+        return self.jobs.submit(jobs.Job(
+            "PTI Inversion",
+            task=task,
+            process_task=task,
+            on_finished=functools.partial(process_inversion_data,
+                                          f"{self.interferometer.destination_folder}/Offline_PTI_Inversion.csv")
+        ))
+
+    def submit_characterisation(self, characterisation_path: str) -> jobs.Job:
+        # The characteristic parameters are needed in the GUI process, hence no process task.
+        return self.jobs.submit(jobs.Job(
+            "Characterisation",
+            task=functools.partial(characterise, characterisation_path, self.interferometer.settings_path,
+                                   self.interferometer.destination_folder),
+            on_finished=functools.partial(process_characterization_data,
+                                          f"{self.interferometer.destination_folder}/Offline_Characterisation.csv")
+        ))
+
+
+# The following functions are the tasks of the offline calculations. Every job builds its own
+# algorithm objects, so jobs running at the same time, in threads or processes, share no state.
+# They only get picklable arguments, so they can be run in a process as well.
+def decimate(decimation_path: str, destination_folder: str, path_prefix: str) -> Generator[float, None, None]:
+    decimation = algorithm.pti.Decimation()
+    decimation.file_path = decimation_path
+    decimation.destination_folder = destination_folder
+    decimation.path_prefix = path_prefix
+    logging.info("Starting Decimation of Raw Data")
+    yield from decimation.calculate_offline()
+
+
+def _interferometer(settings_path: str, destination_folder: str) -> algorithm.interferometry.Interferometer:
+    interferometer = algorithm.interferometry.Interferometer(settings_path=settings_path)
+    interferometer.destination_folder = destination_folder
+    interferometer.load_settings()
+    return interferometer
+
+
+def calculate_interferometry(interferometry_path: str, settings_path: str,
+                             destination_folder: str) -> Generator[float, None, None]:
+    interferometer = _interferometer(settings_path, destination_folder)
+    yield from interferometer.calculate_offline(interferometry_path)
+
+
+def calculate_inversion(inversion_path: str, settings_path: str,
+                        destination_folder: str) -> Generator[float, None, None]:
+    inversion = algorithm.pti.Inversion(interferometer=_interferometer(settings_path, destination_folder),
+                                        decimation=algorithm.pti.Decimation(), settings_path=settings_path)
+    inversion.destination_folder = destination_folder
+    yield from inversion.calculate_offline(inversion_path)
+
+
+def characterise(characterisation_path: str, settings_path: str,
+                 destination_folder: str) -> Generator[float, None, None]:
+    interferometer = _interferometer(settings_path, destination_folder)
+    characterization = algorithm.interferometry.Characterization(interferometer)
+    characterization.destination_folder = destination_folder
+    yield from characterization.characterise_offline(file_path=characterisation_path)
+    signals.CALCULATION.settings_interferometer.emit(interferometer.characteristic_parameter)
 
 
 def find_delimiter(file_path: str) -> str | None:
@@ -211,9 +360,9 @@ def process_inversion_data(inversion_file_path: str) -> None:
         headers = ["PTI Signal"]
         data = _process_data(inversion_file_path, headers)
         send_data["PTI Signal"] = data
-        rolling_window = pd.DataFrame(data).rolling(60, center=True)
-        send_data["PTI Signal 60 s Mean"] = rolling_window.mean()
-        send_data["PTI Signal 60 s Median"] = rolling_window.median()
+        mean, median = algorithm.backend.get("rolling")(data, 60)
+        send_data["PTI Signal 60 s Mean"] = mean
+        send_data["PTI Signal 60 s Median"] = median
     except FileNotFoundError:
         return
     signals.CALCULATION.inversion.emit(send_data)
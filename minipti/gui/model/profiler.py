@@ -0,0 +1,152 @@
+"""
+Sampling profiler of all threads of the application.
+
+A thread samples the Python stack of every other thread at a fixed interval and counts identical
+stacks. Calls into extensions (numpy, numba, Qt, the serial port) have no Python frame, their time
+is attributed to the calling line, which is part of every frame. The profile is written into the
+destination folder as collapsed stacks (flamegraph.pl, inferno) or as speedscope JSON.
+"""
+import collections
+import json
+import logging
+import os
+import sys
+import threading
+import time
+from datetime import datetime
+from typing import Final, NamedTuple
+
+import minipti
+from minipti.gui.model import signals
+
+
+class Frame(NamedTuple):
+    function: str
+    module: str
+    line: int
+
+    def __str__(self) -> str:
+        return f"{self.function} ({self.module}:{self.line})"
+
+
+class Profiler:
+    FORMATS: Final = ("collapsed", "speedscope")
+
+    def __init__(self, interval: float = 0.01, output_format: str = "speedscope"):
+        if output_format not in Profiler.FORMATS:
+            raise ValueError(f"Unknown profile format {output_format}")
+        self.interval = interval  # s
+        self.output_format = output_format
+        self.destination_folder = os.getcwd()
+        self._stacks: collections.Counter[tuple[str, tuple[Frame, ...]]] = collections.Counter()
+        self._stop = threading.Event()
+        self._thread: threading.Thread | None = None
+        self._start = datetime.now()
+        self._duration = 0.  # s
+        signals.GENERAL_PURPORSE.destination_folder_changed.connect(self._update_destination_folder)
+
+    def _update_destination_folder(self, destination_folder: str) -> None:
+        self.destination_folder = destination_folder
+
+    @property
+    def running(self) -> bool:
+        return self._thread is not None
+
+    @property
+    def samples(self) -> int:
+        return sum(self._stacks.values())
+
+    def start(self) -> None:
+        if self.running:
+            return
+        self._stacks.clear()
+        self._stop.clear()
+        self._start = datetime.now()
+        self._thread = threading.Thread(target=self._run, name="Profiler", daemon=True)
+        self._thread.start()
+        signals.GENERAL_PURPORSE.profiler_running.emit(True)
+        logging.info("Started profiling every %g ms", self.interval * 1e3)
+
+    def stop(self) -> str | None:
+        """
+        Returns:
+            The path of the written profile.
+        """
+        if not self.running:
+            return None
+        self._stop.set()
+        self._thread.join()
+        self._thread = None
+        signals.GENERAL_PURPORSE.profiler_running.emit(False)
+        file_path = self.save(f"{self.destination_folder}/{minipti.path_prefix}_Profile_"
+                              f"{self._start.strftime('%H%M%S')}")
+        logging.info("Profiled %d samples in %.0f s, saved to %s", self.samples, self._duration, file_path)
+        return file_path
+
+    def toggle(self) -> None:
+        if self.running:
+            self.stop()
+        else:
+            self.start()
+
+    def _run(self) -> None:
+        own = threading.get_ident()
+        start = time.monotonic()
+        while not self._stop.wait(self.interval):
+            self._sample(own)
+        self._duration = time.monotonic() - start
+
+    def _sample(self, own: int) -> None:
+        names = {thread.ident: thread.name for thread in threading.enumerate()}
+        for ident, frame in sys._current_frames().items():
+            if ident == own:
+                continue
+            stack = []
+            while frame is not None:
+                code = frame.f_code
+                stack.append(Frame(getattr(code, "co_qualname", code.co_name),
+                                   frame.f_globals.get("__name__", code.co_filename), frame.f_lineno))
+                frame = frame.f_back
+            self._stacks[names.get(ident, str(ident)), tuple(reversed(stack))] += 1
+
+    def save(self, file_path: str) -> str:
+        """
+        Writes the profile with the extension of the output format to file_path.
+        """
+        if self.output_format == "collapsed":
+            file_path = f"{file_path}.txt"
+            with open(file_path, "w") as profile:
+                profile.write(self.collapsed())
+        else:
+            file_path = f"{file_path}.speedscope.json"
+            with open(file_path, "w") as profile:
+                json.dump(self.speedscope(), profile)
+        return file_path
+
+    def collapsed(self) -> str:
+        """
+        One line per stack with the thread as root frame, ; separated frames and the sample count.
+        """
+        return "".join(f"{';'.join([thread, *map(str, stack)])} {count}\n"
+                       for (thread, stack), count in self._stacks.items())
+
+    def speedscope(self) -> dict:
+        """
+        One sampled profile per thread in the speedscope file format.
+        """
+        frames: dict[Frame, int] = {}
+        profiles: dict[str, dict] = {}
+        for (thread, stack), count in self._stacks.items():
+            profile = profiles.setdefault(thread, {"type": "sampled", "name": thread, "unit": "seconds",
+                                                   "startValue": 0, "endValue": self._duration, "samples": [],
+                                                   "weights": []})
+            profile["samples"].append([frames.setdefault(frame, len(frames)) for frame in stack])
+            profile["weights"].append(count * self.interval)
+        return {
+            "$schema": "https://www.speedscope.app/file-format-schema.json",
+            "name": f"MiniPTI {self._start.isoformat(timespec='seconds')}",
+            "exporter": "MiniPTI",
+            "shared": {"frames": [{"name": frame.function, "file": frame.module, "line": frame.line}
+                                  for frame in frames]},
+            "profiles": list(profiles.values())
+        }
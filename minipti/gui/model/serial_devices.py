@@ -12,12 +12,16 @@ from dataclasses import asdict, dataclass
 from datetime import datetime
 
 import pandas as pd
+from PyQt5 import QtCore
 from notifypy import Notify
 from overrides import override
 
 import minipti
 from minipti import hardware
 from minipti.gui.model import buffer, configuration
+from minipti.gui.model import general_purpose
+from minipti.gui.model import load
+from minipti.gui.model import power
 from minipti.gui.model import signals
 
 LaserData = hardware.laser.Data
@@ -75,6 +79,13 @@ class Serial(ABC):
     def load_configuration(self) -> None:
         self.fire_configuration_change()
 
+    def _configuration_applied(self, transaction: hardware.serial_device.Transaction) -> None:
+        """
+        A rejected configuration is restored to the last acknowledged state, which is shown again.
+        """
+        if not transaction.succeeded and not transaction.discarded:
+            self.fire_configuration_change()
+
     def _incoming_data(self) -> None:
         """
         Listens to incoming data and emits them as _signals to the view as long a serial connection
@@ -82,7 +93,8 @@ class Serial(ABC):
         """
 
     def process_measured_data(self) -> threading.Thread:
-        processing_thread = threading.Thread(target=self._incoming_data, name="Incoming Data", daemon=True)
+        processing_thread = threading.Thread(target=self._incoming_data, name=f"{type(self).__name__} Incoming Data",
+                                             daemon=True)
         processing_thread.start()
         return processing_thread
 
@@ -91,6 +103,10 @@ class DAQ(Serial):
     def __init__(self, driver: hardware.motherboard.Driver):
         Serial.__init__(self, driver)
         self.driver = driver
+        realtime = configuration.GUI.realtime
+        if realtime.use:
+            self.driver.realtime = hardware.realtime.Profile(realtime.cpus, realtime.fifo_priority, realtime.nice,
+                                                             realtime.lock_memory)
 
     @property
     def ref_signal(self) -> deque:
@@ -133,6 +149,14 @@ class DAQ(Serial):
     @property
     def number_of_samples(self) -> int:
         return self.driver.daq.number_of_samples
+
+    @property
+    def sample_rate(self) -> int:
+        return self.driver.daq.sample_rate
+
+    @property
+    def ref_period(self) -> int:
+        return self.driver.daq.ref_period
     
     @number_of_samples.setter
     def number_of_samples(self, number_of_sampes: int) -> None:
@@ -201,6 +225,8 @@ class BMS(Serial):
                 bms_data.charging,
                 bms_data.battery_percentage
             )
+            if configuration.GUI.power.use:
+                power.MANAGER.update(bms_data)
             if self.driver.sampling and configuration.GUI.save.bms:
                 self._save_data(bms_data)
 
@@ -443,17 +469,18 @@ class Laser(Serial):
         ...
 
     @abstractmethod
-    def apply_configuration(self) -> None:
+    def apply_configuration(self) -> hardware.serial_device.Transaction:
         ...
 
     def _incoming_data(self):
         while self.driver.connected.is_set():
             received_data: hardware.laser.Data = self.driver.data.get(block=True)
-            Laser.buffer.append(received_data)
-            signals.LASER.data.emit(Laser.buffer)
-            signals.LASER.data_display.emit(received_data)
-            if self.driver.sampling and configuration.GUI.save.laser:
-                self._save_data(received_data)
+            with load.SAMPLER.iteration():
+                Laser.buffer.append(received_data)
+                signals.LASER.data.emit(Laser.buffer.snapshot())
+                signals.LASER.data_display.emit(received_data)
+                if self.driver.sampling and configuration.GUI.save.laser:
+                    self._save_data(received_data)
 
 
     @override
@@ -508,7 +535,7 @@ class PumpLaser(Laser):
 
     def start_up(self) -> None:
         self.pump_laser.initialize()
-        self.pump_laser.apply_configuration()
+        self.apply_configuration()
 
     @property
     def connected(self) -> bool:
@@ -544,8 +571,10 @@ class PumpLaser(Laser):
         self.pump_laser.load_configuration()
 
     @override
-    def apply_configuration(self) -> None:
-        self.pump_laser.apply_configuration()
+    def apply_configuration(self) -> hardware.serial_device.Transaction:
+        transaction = self.pump_laser.apply_configuration()
+        transaction.add_done_callback(self._configuration_applied)
+        return transaction
 
     def fire_driver_bits_signal(self) -> None:
         bits: int = self.pump_laser.configuration.bit_value
@@ -678,7 +707,7 @@ class ProbeLaser(Laser):
 
     def start_up(self) -> None:
         self.probe_laser.initialize()
-        self.probe_laser.apply_configuration()
+        self.apply_configuration()
 
     @property
     def connected(self) -> bool:
@@ -802,8 +831,10 @@ class ProbeLaser(Laser):
         self.fire_max_current_signal()
 
     @override
-    def apply_configuration(self) -> None:
-        self.probe_laser.apply_configuration()
+    def apply_configuration(self) -> hardware.serial_device.Transaction:
+        transaction = self.probe_laser.apply_configuration()
+        transaction.add_done_callback(self._configuration_applied)
+        return transaction
 
 
 class Tec(Serial):
@@ -851,8 +882,10 @@ class Tec(Serial):
         self.tec.load_configuration()
         self.fire_configuration_change()
 
-    def apply_configuration(self) -> None:
-        self.tec.apply_configuration()
+    def apply_configuration(self) -> hardware.serial_device.Transaction:
+        transaction = self.tec.apply_configuration()
+        transaction.add_done_callback(self._configuration_applied)
+        return transaction
 
     @property
     def p_value(self) -> float:
@@ -922,11 +955,12 @@ class Tec(Serial):
     def _incoming_data(self) -> None:
         while self.driver.connected.is_set():
             received_data: hardware.tec.Data = self.driver.data.get(block=True)
-            self._buffer.append(received_data)
-            signals.GENERAL_PURPORSE.tec_data.emit(self._buffer)
-            signals.GENERAL_PURPORSE.tec_data_display.emit(received_data)
-            if self.driver.sampling and configuration.GUI.save.tec:
-                self._save_data(received_data)
+            with load.SAMPLER.iteration():
+                self._buffer.append(received_data)
+                signals.GENERAL_PURPORSE.tec_data.emit(self._buffer.snapshot())
+                signals.GENERAL_PURPORSE.tec_data_display.emit(received_data)
+                if self.driver.sampling and configuration.GUI.save.tec:
+                    self._save_data(received_data)
 
     @override
     def _save_data(self, received_data) -> None:
@@ -987,3 +1021,55 @@ class Tools:
 
 
 TOOLS: typing.Final = Tools()
+
+
+class CommandLatencyTable(general_purpose.Table):
+    """
+    Rolling round trip statistics of the commands of a driver.
+    """
+    def __init__(self, driver: hardware.serial_device.Driver):
+        general_purpose.Table.__init__(self)
+        self.driver = driver
+        self.update()
+
+    @property
+    def _headers(self) -> list[str]:
+        return list(self._data.columns)
+
+    @property
+    def _indices(self) -> list[str]:
+        return list(self._data.index)
+
+    def data(self, index, role: int = ...) -> str | None:
+        if index.isValid() and role == QtCore.Qt.DisplayRole:
+            value = self._data.iloc[index.row(), index.column()]
+            return f"{value:.1f}" if isinstance(value, float) else str(value)
+        return None
+
+    def flags(self, index):
+        return QtCore.Qt.ItemIsSelectable | QtCore.Qt.ItemIsEnabled
+
+    def update(self) -> None:
+        self.beginResetModel()
+        self._data = self.driver.command_latency.summary()
+        self.endResetModel()
+
+
+class CommandLatency:
+    def __init__(self):
+        self._destination_folder = os.getcwd()
+        self.tables = [CommandLatencyTable(driver) for driver in (DRIVER.motherboard, DRIVER.laser, DRIVER.tec)]
+        signals.GENERAL_PURPORSE.destination_folder_changed.connect(self._update_destination_folder)
+
+    def _update_destination_folder(self, destination_folder: str) -> None:
+        self._destination_folder = destination_folder
+
+    def update(self) -> None:
+        for table in self.tables:
+            table.update()
+
+    def save(self) -> None:
+        for table in self.tables:
+            file_path = f"{self._destination_folder}/{minipti.path_prefix}_{table.driver.device_name}_Command_Latency"
+            table.driver.command_latency.save(file_path)
+            logging.info("Saved command latency of %s to %s", table.driver.device_name, file_path)
@@ -31,11 +31,14 @@ class _GeneralPurporse(QtCore.QObject):
     logging_update = QtCore.pyqtSignal(deque)
     destination_folder_changed = QtCore.pyqtSignal(str)
     theme_changed = QtCore.pyqtSignal(str)
-    tec_data = QtCore.pyqtSignal(buffer.Tec)
+    tec_data = QtCore.pyqtSignal(buffer.Snapshot)
     tec_data_display = QtCore.pyqtSignal(hardware.tec.Data)
     progess_bar = QtCore.pyqtSignal(int)
     progess_bar_start = QtCore.pyqtSignal()
     progess_bar_stop = QtCore.pyqtSignal()
+    progess_bar_eta = QtCore.pyqtSignal(float)
+    thread_load = QtCore.pyqtSignal(list)
+    profiler_running = QtCore.pyqtSignal(bool)
 
     def __init__(self):
         QtCore.QObject.__init__(self)
@@ -50,7 +53,7 @@ class _Laser(QtCore.QObject):
     laser_voltage = QtCore.pyqtSignal(int, float)
     current_dac = QtCore.pyqtSignal(int, int)
     matrix_dac = QtCore.pyqtSignal(int, list)
-    data = QtCore.pyqtSignal(buffer.BaseClass)
+    data = QtCore.pyqtSignal(buffer.Snapshot)
     data_display = QtCore.pyqtSignal(hardware.laser.Data)
     pump_laser_enabled = QtCore.pyqtSignal(bool)
     probe_laser_enabled = QtCore.pyqtSignal(bool)
@@ -95,10 +98,10 @@ class _Pump(QtCore.QObject):
 
 @dataclass(init=False, frozen=True)
 class _DAQ(QtCore.QObject):
-    decimation = QtCore.pyqtSignal(buffer.BaseClass)
-    inversion = QtCore.pyqtSignal(buffer.BaseClass)
-    interferometry = QtCore.pyqtSignal(buffer.BaseClass)
-    characterization = QtCore.pyqtSignal(buffer.BaseClass)
+    decimation = QtCore.pyqtSignal(buffer.Snapshot)
+    inversion = QtCore.pyqtSignal(buffer.Snapshot)
+    interferometry = QtCore.pyqtSignal(buffer.Snapshot)
+    characterization = QtCore.pyqtSignal(buffer.Snapshot)
     samples_changed = QtCore.pyqtSignal(int)
     running = QtCore.pyqtSignal(bool)
     clear = QtCore.pyqtSignal()
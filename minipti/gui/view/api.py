@@ -79,6 +79,7 @@ class MainWindow(QtWidgets.QMainWindow):
         model.signals.GENERAL_PURPORSE.progess_bar.connect(self.update_progess_bar)
         model.signals.GENERAL_PURPORSE.progess_bar_start.connect(self.start_progess_bar)
         model.signals.GENERAL_PURPORSE.progess_bar_stop.connect(self.stop_progess_bar)
+        model.signals.GENERAL_PURPORSE.progess_bar_eta.connect(self.update_progess_bar_eta)
         self.show()
 
     def start_progess_bar(self) -> None:
@@ -86,10 +87,14 @@ class MainWindow(QtWidgets.QMainWindow):
 
     def stop_progess_bar(self) -> None:
         self.progress_bar.close()
+        self.progress_bar.setFormat("%p%")
 
     def update_progess_bar(self, progress: int) -> None:
         self.progress_bar.setValue(progress)
 
+    def update_progess_bar_eta(self, eta: float) -> None:
+        self.progress_bar.setFormat(f"%p% (ETA {eta:.0f} s)")
+
     def keyPressEvent(self, e):
         if e.key() == Qt.Key_F1:
             self.controllers.toolbar.show_settings()
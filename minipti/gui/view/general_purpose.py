@@ -162,6 +162,10 @@ class StatusBar(QtWidgets.QStatusBar):
             self.charging_indicator.setIconSize(QtCore.QSize(30, 40))
             self.addPermanentWidget(self.charging_indicator)
             model.signals.BMS.battery_state.connect(self.update_battery_state)
+        if model.configuration.GUI.load.use:
+            self.thread_load = QtWidgets.QLabel()
+            self.addPermanentWidget(self.thread_load)
+            model.signals.GENERAL_PURPORSE.thread_load.connect(self.update_thread_load)
         model.signals.VALVE.bypass.connect(self.update_valve_state)
         model.signals.PUMP.enabled.connect(self.update_pump)
 
@@ -190,6 +194,11 @@ class StatusBar(QtWidgets.QStatusBar):
         else:
             self.pump.setStyleSheet("background-color : light gray")
 
+    @QtCore.pyqtSlot(list)
+    def update_thread_load(self, loads: list[model.load.ThreadLoad]) -> None:
+        self.thread_load.setText(model.load.summary(loads))
+        self.thread_load.setToolTip("\n".join(str(load) for load in loads))
+
     @QtCore.pyqtSlot(bool, float)
     def update_battery_state(self, charging: bool, percentage: int) -> None:
         self._set_battery_icon(percentage, charging)
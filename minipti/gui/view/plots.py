@@ -1,3 +1,5 @@
+import math
+import time
 from abc import abstractmethod
 
 import matplotlib
@@ -32,6 +34,11 @@ class Plotting(pg.PlotWidget):
         self.curves = self.plot.plot(pen=pg.mkPen(_MatplotlibColors.BLUE))
         self.plot.showGrid(x=True, y=True)
         self.legend = self.plot.addLegend()
+        self._source: model.buffer.BaseClass | None = None
+        self._browsing = False
+        self._last_update = -math.inf
+        self.plot.getViewBox().sigRangeChangedManually.connect(self._browse_history)
+        self.plot.getViewBox().sigStateChanged.connect(self._follow_live)
 
     def update_theme(self, theme: str) -> None:
         if theme == "Dark":
@@ -59,8 +66,38 @@ class Plotting(pg.PlotWidget):
     def clear(self) -> None:
         self.window.clear()
 
+    def _update_data_live(self, data: model.buffer.Snapshot) -> None:
+        self._source = data.source
+        # A snapshot which has been overtaken by the writer is skipped, a newer one is already queued.
+        if not data.valid or self._browsing:
+            return
+        # Every snapshot holds the whole plotted range, so skipping some for a saving profile loses nothing.
+        now = time.monotonic()
+        if now - self._last_update < model.power.MANAGER.profile.plot_period:
+            return
+        # The plot keeps the arrays it is given, so it gets its own copy, which is checked like a seqlock read.
+        owned = data.owned()
+        if not data.valid:
+            return
+        self._last_update = now
+        self.update_data_live(owned)
+
+    def _browse_history(self) -> None:
+        """
+        Panning or zooming shows the history of the visible range until auto range is enabled again.
+        """
+        if self._source is None:
+            return
+        self._browsing = True
+        start, end = self.plot.getViewBox().viewRange()[0]
+        self.update_data_live(self._source.history_snapshot(start, end))
+
+    def _follow_live(self) -> None:
+        if self._browsing and self.plot.getViewBox().autoRangeEnabled()[0]:
+            self._browsing = False
+
     @abstractmethod
-    def update_data_live(self, data: model.buffer.BaseClass) -> None:
+    def update_data_live(self, data: model.buffer.Snapshot) -> None:
         ...
 
 
@@ -71,7 +108,7 @@ class DAQPlots(Plotting):
         self.name = ""
 
     @abstractmethod
-    def update_data_live(self, data: model.buffer.BaseClass) -> None:
+    def update_data_live(self, data: model.buffer.Snapshot) -> None:
         ...
 
 
@@ -98,10 +135,10 @@ class DC(DAQPlots):
         self.plot.setLabel(axis="bottom", text="Time [s]")
         self.plot.setLabel(axis="left", text="Intensity [V]")
         self.name = "DC Plots"
-        model.signals.DAQ.interferometry.connect(self.update_data_live)
+        model.signals.DAQ.interferometry.connect(self._update_data_live)
 
     @override(check_signature=False)
-    def update_data_live(self, data: model.buffer.Interferometer) -> None:
+    def update_data_live(self, data: model.buffer.InterferometerSnapshot) -> None:
         for channel in range(3):
             self.curves[channel].setData(data.time, data.dc_values[channel])
 
@@ -121,10 +158,10 @@ class Amplitudes(DAQPlots):
         self.plot.setLabel(axis="bottom", text="Time [s]")
         self.plot.setLabel(axis="left", text="Amplitude [V]")
         self.name = "Amplitudes"
-        model.signals.DAQ.characterization.connect(self.update_data_live)
+        model.signals.DAQ.characterization.connect(self._update_data_live)
 
     @override(check_signature=False)
-    def update_data_live(self, data: model.buffer.Characterisation) -> None:
+    def update_data_live(self, data: model.buffer.CharacterisationSnapshot) -> None:
         for channel in range(3):
             self.curves[channel].setData(data.time, data.amplitudes[channel])
 
@@ -139,10 +176,10 @@ class OutputPhases(DAQPlots):
         self.plot.setLabel(axis="bottom", text="Time [s]")
         self.plot.setLabel(axis="left", text="Output Phase [deg]")
         self.name = "Output Phases"
-        model.signals.DAQ.characterization.connect(self.update_data_live)
+        model.signals.DAQ.characterization.connect(self._update_data_live)
 
     @override(check_signature=False)
-    def update_data_live(self, data: model.buffer.Characterisation) -> None:
+    def update_data_live(self, data: model.buffer.CharacterisationSnapshot) -> None:
         for channel in range(2):
             self.curves[channel].setData(data.time, np.rad2deg(data.output_phases[channel]))
 
@@ -182,10 +219,10 @@ class InterferometricPhase(DAQPlots):
         self.plot.setLabel(axis="bottom", text="Time [s]")
         self.plot.setLabel(axis="left", text="Interferometric Phase [rad]")
         self.name = "Interferometric Phase"
-        model.signals.DAQ.interferometry.connect(self.update_data_live)
+        model.signals.DAQ.interferometry.connect(self._update_data_live)
 
     @override(check_signature=False)
-    def update_data_live(self, data: model.buffer.Interferometer) -> None:
+    def update_data_live(self, data: model.buffer.InterferometerSnapshot) -> None:
         self.curves.setData(data.time, data.interferometric_phase)
 
 
@@ -208,10 +245,10 @@ class Sensitivity(DAQPlots):
         self.plot.setLabel(axis="bottom", text="Time [s]")
         self.plot.setLabel(axis="left", text="Sensitivity [V/rad]")
         self.name = "Sensitivity"
-        model.signals.DAQ.interferometry.connect(self.update_data_live)
+        model.signals.DAQ.interferometry.connect(self._update_data_live)
 
     @override(check_signature=False)
-    def update_data_live(self, data: model.buffer.Interferometer) -> None:
+    def update_data_live(self, data: model.buffer.InterferometerSnapshot) -> None:
         for channel in range(3):
             self.curves[channel].setData(data.time, data.sensitivity[channel])
 
@@ -226,10 +263,10 @@ class Symmetry(DAQPlots):
         self.plot.setLabel(axis="bottom", text="Time [s]")
         self.plot.setLabel(axis="left", text="Symmetry [%]")
         self.name = "Symmetry"
-        model.signals.DAQ.characterization.connect(self.update_data_live)
+        model.signals.DAQ.characterization.connect(self._update_data_live)
 
     @override(check_signature=False)
-    def update_data_live(self, data: model.buffer.Characterisation) -> None:
+    def update_data_live(self, data: model.buffer.CharacterisationSnapshot) -> None:
         self.curves[0].setData(data.time, data.symmetry)
         self.curves[1].setData(data.time, data.relative_symmetry)
 
@@ -329,10 +366,10 @@ class PTISignal(DAQPlots):
         self.plot.setLabel(axis="bottom", text="Time [s]")
         self.plot.setLabel(axis="left", text="PTI Signal [µrad]")
         self.name = "PTI Signal"
-        model.signals.DAQ.inversion.connect(self.update_data_live)
+        model.signals.DAQ.inversion.connect(self._update_data_live)
 
     @override(check_signature=False)
-    def update_data_live(self, data: model.buffer.PTI) -> None:
+    def update_data_live(self, data: model.buffer.PTISnapshot) -> None:
         self.curves["PTI Signal"].setData(data.time, data.pti_signal)
         self.curves["PTI Signal Mean"].setData(data.time, data.pti_signal_mean)
         self.curves["PTI Signal Median"].setData(data.time, data.pti_signal_median)
@@ -354,10 +391,10 @@ class PumpLaserCurrent(Plotting):
         self.curves = self.plot.plot(pen=pg.mkPen(_MatplotlibColors.BLUE))
         self.plot.setLabel(axis="bottom", text="Time [s]")
         self.plot.setLabel(axis="left", text="Current [mA]")
-        model.signals.LASER.data.connect(self.update_data_live)
+        model.signals.LASER.data.connect(self._update_data_live)
 
     @override(check_signature=False)
-    def update_data_live(self, data: model.buffer.Laser) -> None:
+    def update_data_live(self, data: model.buffer.LaserSnapshot) -> None:
         self.curves.setData(data.time, data.pump_laser_current)
 
 
@@ -367,10 +404,10 @@ class ProbeLaserCurrent(Plotting):
         self.curves = self.plot.plot(pen=pg.mkPen(_MatplotlibColors.BLUE))
         self.plot.setLabel(axis="bottom", text="Time [s]")
         self.plot.setLabel(axis="left", text="Current [mA]")
-        model.signals.LASER.data.connect(self.update_data_live)
+        model.signals.LASER.data.connect(self._update_data_live)
 
     @override(check_signature=False)
-    def update_data_live(self, data: model.buffer.Laser) -> None:
+    def update_data_live(self, data: model.buffer.LaserSnapshot) -> None:
         self.curves.setData(data.time, data.probe_laser_current)
 
 
@@ -385,9 +422,9 @@ class TecTemperature(Plotting):
         self.plot.setLabel(axis="bottom", text="Time [s]")
         self.plot.setLabel(axis="left", text="Temperature [°C]")
         self.laser = channel
-        model.signals.GENERAL_PURPORSE.tec_data.connect(self.update_data_live)
+        model.signals.GENERAL_PURPORSE.tec_data.connect(self._update_data_live)
 
     @override(check_signature=False)
-    def update_data_live(self, data: model.buffer.Tec) -> None:
+    def update_data_live(self, data: model.buffer.TecSnapshot) -> None:
         self.curves[TecTemperature.SET_POINT].setData(data.time, data.set_point[self.laser])
         self.curves[TecTemperature.MEASURED].setData(data.time, data.actual_value[self.laser])
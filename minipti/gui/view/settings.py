@@ -35,7 +35,7 @@ class SampleSettings(QtWidgets.QWidget):
     def __init__(self, settings_controller: controller.interface.Settings):
         QtWidgets.QWidget.__init__(self)
         self.setLayout(QtWidgets.QVBoxLayout())
-        self.samples = QtWidgets.QLabel("8000 Samples")
+        self.samples = QtWidgets.QLabel(f"{model.serial_devices.TOOLS.daq.number_of_samples} Samples")
         self.controller = settings_controller
         self.average_period = QtWidgets.QComboBox()
         self._init_average_period_box()
@@ -43,18 +43,22 @@ class SampleSettings(QtWidgets.QWidget):
         model.signals.DAQ.samples_changed.connect(self.update_average_period)
 
     def _init_average_period_box(self) -> None:
-        for i in range(1, 80):
-            self.average_period.addItem(f"{i * 100 / 8000 * 1000} ms")
-        for i in range(80, 320 + 1):
-            self.average_period.addItem(f"{i * 100 / 8000} s")
-        self.average_period.setCurrentIndex(80 - 1)
+        # Every period is a multiple of the reference period, from one of them up to 4 s.
+        ref_period = model.serial_devices.TOOLS.daq.ref_period
+        sample_rate = model.serial_devices.TOOLS.daq.sample_rate
+        periods_per_second = sample_rate // ref_period
+        for i in range(1, periods_per_second):
+            self.average_period.addItem(f"{i * ref_period / sample_rate * 1000} ms")
+        for i in range(periods_per_second, 4 * periods_per_second + 1):
+            self.average_period.addItem(f"{i * ref_period / sample_rate} s")
+        self.average_period.setCurrentIndex(periods_per_second - 1)
         self.layout().addWidget(QtWidgets.QLabel("Averaging Time"))
         self.layout().addWidget(self.average_period)
         self.layout().addWidget(self.samples)
         self.average_period.currentIndexChanged.connect(self.update_samples)
 
     def update_average_period(self, samples: int) -> None:
-        self.average_period.setCurrentIndex(samples // 100 - 1)
+        self.average_period.setCurrentIndex(samples // model.serial_devices.TOOLS.daq.ref_period - 1)
 
     def update_samples(self) -> None:
         self.controller.update_sample_setting()
@@ -1,12 +1,12 @@
 from abc import abstractmethod
 
-from PyQt5 import QtWidgets, QtGui
+from PyQt5 import QtWidgets, QtGui, QtCore
 from matplotlib import pyplot as plt
 from overrides import override
 
 import minipti
 from minipti.gui import controller, model
-from minipti.gui.view import helper
+from minipti.gui.view import helper, table
 
 
 class UtilitiesWindow(QtWidgets.QMainWindow):
@@ -19,8 +19,11 @@ class UtilitiesWindow(QtWidgets.QMainWindow):
         self.setWindowTitle("Utilities")
         self.parent.layout().addWidget(self.calculation, 0, 0)
         self.parent.layout().addWidget(self.plotting, 1, 0)
+        if model.configuration.GUI.utilities.profiler.use:
+            self.diagnostics = Diagnostics(utilities_controller)
+            self.parent.layout().addWidget(self.diagnostics, 2, 0)
         self.setCentralWidget(self.parent)
-        self.setFixedSize(300, 400)
+        self.setFixedSize(300, 480 if model.configuration.GUI.utilities.profiler.use else 400)
         self.setWindowIcon(QtGui.QIcon(f"{minipti.MODULE_PATH}/gui/images/Utilities.png"))
         self.progessbar = QtWidgets.QProgressBar()
 
@@ -66,6 +69,8 @@ class Calculation(UtilitiesBase):
         if model.configuration.GUI.utilities.calculate.characterisation:
             self.characterisation = helper.create_button(parent=self, title="Interferometer Characterisation",
                                                          slot=self.controller.calculate_characterisation)
+        if model.configuration.GUI.utilities.calculate.use:
+            self.cancel = helper.create_button(parent=self, title="Cancel", slot=self.controller.cancel_calculations)
 
 
 class Plotting(UtilitiesBase):
@@ -91,4 +96,51 @@ class Plotting(UtilitiesBase):
                                                    slot=self.controller.plot_inversion)
 
             self.characterisation = helper.create_button(parent=self, title="Interferometer Characterisation",
-                                                   slot=self.controller.plot_characterisation)
\ No newline at end of file
+                                                   slot=self.controller.plot_characterisation)
+
+
+class Diagnostics(UtilitiesBase):
+    def __init__(self, utilities_controller: controller.interface.Utilities):
+        UtilitiesBase.__init__(self, utilities_controller)
+        self.setTitle("Diagnostics")
+        model.signals.GENERAL_PURPORSE.profiler_running.connect(self.update_profiler)
+
+    @override
+    def _init_button(self) -> None:
+        self.profiler = helper.create_button(parent=self, title="Start Profiler", slot=self.controller.toggle_profiler)
+        self.command_latency = helper.create_button(parent=self, title="Command Latency",
+                                                    slot=self.controller.show_command_latency)
+
+    def update_profiler(self, running: bool) -> None:
+        self.profiler.setText("Stop Profiler" if running else "Start Profiler")
+
+
+class CommandLatencyWindow(QtWidgets.QMainWindow):
+    UPDATE_INTERVAL = 1000  # ms
+
+    def __init__(self, utilities_controller: controller.interface.Utilities,
+                 tables: list[model.serial_devices.CommandLatencyTable]):
+        QtWidgets.QMainWindow.__init__(self)
+        self.controller = utilities_controller
+        self.setWindowTitle("Command Latency")
+        self.setWindowIcon(QtGui.QIcon(f"{minipti.MODULE_PATH}/gui/images/Utilities.png"))
+        self.parent = QtWidgets.QWidget()
+        self.parent.setLayout(QtWidgets.QVBoxLayout())
+        self.devices = QtWidgets.QTabWidget()
+        for command_table in tables:
+            self.devices.addTab(table.Table(self, command_table), command_table.driver.device_name)
+        self.parent.layout().addWidget(self.devices)
+        self.export = helper.create_button(parent=self.parent, title="Export",
+                                           slot=self.controller.save_command_latency)
+        self.setCentralWidget(self.parent)
+        self.resize(700, 400)
+        self.timer = QtCore.QTimer(self)
+        self.timer.timeout.connect(self.controller.update_command_latency)
+
+    def showEvent(self, event) -> None:
+        self.timer.start(CommandLatencyWindow.UPDATE_INTERVAL)
+        super().showEvent(event)
+
+    def hideEvent(self, event) -> None:
+        self.timer.stop()
+        super().hideEvent(event)
@@ -1,5 +1,7 @@
+from . import emulator
 from . import laser
 from . import motherboard
 from . import protocolls
+from . import realtime
 from . import serial_device
 from . import tec
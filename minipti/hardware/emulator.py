@@ -0,0 +1,131 @@
+"""
+Emulated devices for simulations and tests without hardware.
+"""
+
+import numpy as np
+import pandas as pd
+from fastcrc import crc16
+
+from minipti import algorithm
+from . import motherboard
+
+
+class Interferometer:
+    """
+    Emulates the DC signals of an interferometer. Its phase drifts (linear and as random walk) and is
+    shifted by an actuator, e.g. the probe laser current, which follows its command with a first order lag.
+    """
+    def __init__(self, parameter: algorithm.interferometry.CharacteristicParameter, phase: float = 0,
+                 drift: float = 0.01, random_walk: float = 0.001, actuator_gain: float = 0.05,
+                 actuator_time_constant: float = 0.5, actuator: float = 0, noise: float = 1e-3, seed: int = 0):
+        """
+        Args:
+            drift (float): Linear phase drift in rad/s.
+            random_walk (float): Standard deviation of the phase random walk in rad/sqrt(s).
+            actuator_gain (float): Phase shift per actuator unit in rad.
+            actuator_time_constant (float): Time constant of the actuator in s.
+            noise (float): Standard deviation of the detector noise in V.
+        """
+        self.parameter = parameter
+        self.drift = drift
+        self.random_walk = random_walk
+        self.actuator_gain = actuator_gain
+        self.actuator_time_constant = actuator_time_constant
+        self.noise = noise
+        self.command = actuator
+        self.actuator = actuator
+        self._free_phase = phase - actuator_gain * actuator
+        self._generator = np.random.default_rng(seed)
+
+    @property
+    def phase(self) -> float:
+        return (self._free_phase + self.actuator_gain * self.actuator) % (2 * np.pi)
+
+    def step(self, period: float) -> np.ndarray:
+        """
+        Advances the emulation by period s.
+        Returns:
+            The DC signals of every detector.
+        """
+        self._free_phase += self.drift * period + self._generator.normal(scale=self.random_walk * np.sqrt(period))
+        self.actuator += (self.command - self.actuator) * (1 - np.exp(-period / self.actuator_time_constant))
+        intensities = self.parameter.offsets + self.parameter.amplitudes * np.cos(self.phase
+                                                                                  - self.parameter.output_phases)
+        return intensities + self._generator.normal(scale=self.noise, size=intensities.shape)
+
+
+def simulate_working_point(controller: algorithm.control.WorkingPointController, plant: Interferometer,
+                           duration: float, period: float) -> pd.DataFrame:
+    """
+    Runs the working point control in closed loop against the emulated interferometer.
+    Returns:
+        The phase, total sensitivity, actuator command and phase error of every step.
+    """
+    results = []
+    for step in range(int(duration / period)):
+        intensities = plant.step(period)
+        plant.command = controller.step(intensities, period)
+        results.append({"Time": step * period,
+                        "Interferometric Phase": plant.phase,
+                        "Total Sensitivity": algorithm.control.total_sensitivity(plant.phase, plant.parameter),
+                        "Command": plant.command,
+                        "Phase Error": controller.error})
+    return pd.DataFrame(results).set_index("Time")
+
+
+class Motherboard:
+    """
+    Emulates the serial data of the motherboard. Every DAQ frame contains samples_per_frame samples of
+    the reference, 3 AC and 4 DC channels, which are derived from the emulated interferometer and a PTI
+    signal.
+    """
+    def __init__(self, interferometer: Interferometer, ref_period: int = 100, pti_amplitude: float = 1e-4,
+                 response_phases: np.ndarray | None = None, malformed_rate: float = 0, seed: int = 0,
+                 sample_rate: int = 8000, samples_per_frame: int = motherboard.DAQ.ENCODED_DATA_SIZE):
+        """
+        Args:
+            pti_amplitude (float): Amplitude of the AC signals in V.
+            malformed_rate (float): Probability of a frame being preceded by unterminated garbage.
+            sample_rate (int): Samples per s.
+        """
+        self.interferometer = interferometer
+        self.ref_period = ref_period
+        self.pti_amplitude = pti_amplitude
+        self.response_phases = np.zeros(3) if response_phases is None else response_phases
+        self.malformed_rate = malformed_rate
+        self.sample_rate = sample_rate
+        self.samples_per_frame = samples_per_frame
+        self.configuration = algorithm._utilities.load_configuration(algorithm.pti.DecimationSettings, "pti",
+                                                                     "decimation")
+        self._sample = 0
+        self._sequence = 0
+        self._generator = np.random.default_rng(seed)
+
+    def frames(self, samples: int) -> str:
+        """
+        Returns as many terminated DAQ frames as needed to transmit the next samples.
+        """
+        frames = []
+        for _ in range(-(-samples // self.samples_per_frame)):
+            if self._generator.random() < self.malformed_rate:
+                frames.append(self.garbage(self._generator.integers(1, motherboard.DAQ.PACKAGE_SIZE)))
+            frames.append(self._daq_frame())
+        return "".join(frames)
+
+    def garbage(self, length: int) -> str:
+        return "".join(self._generator.choice(list("0123456789ABCDEF"), size=length))
+
+    def _daq_frame(self) -> str:
+        samples = np.arange(self._sample, self._sample + self.samples_per_frame)
+        self._sample += self.samples_per_frame
+        dc = self.interferometer.step(self.samples_per_frame / self.sample_rate)
+        ac = self.pti_amplitude * np.cos(2 * np.pi / self.ref_period * samples - self.response_phases[:, np.newaxis])
+        ac_bits = self.configuration.amplification * self.configuration.ac_resolution / self.configuration.ref_voltage
+        dc_bits = self.configuration.dc_resolution / self.configuration.ref_voltage
+        words = np.zeros((self.samples_per_frame, 8), dtype=np.int64)
+        words[:, 0] = samples % self.ref_period < self.ref_period // 2
+        words[:, 1:4] = np.clip(ac * ac_bits, -(1 << 15), (1 << 15) - 1).T
+        words[:, 4:7] = np.clip(dc * dc_bits, 0, self.configuration.dc_resolution)
+        frame = f"D{self._sequence:08X}{words.astype('>u2').tobytes().hex().upper()}"
+        self._sequence = (self._sequence + 1) % (1 << 32)
+        return f"{frame}{crc16.arc(frame.encode()):04X}\n"
@@ -69,7 +69,7 @@ class Driver(serial_device.Driver):
     def _encode(self, data: str) -> None:
         if data[0] == "N":
             logging.error(f"Invalid command {data}")
-            self._ready_write.set()
+            self._acknowledge(False)
         elif data[0] == "S" or data[0] == "C":
             self._check_ack(data)
         elif data[0] == "L":
@@ -151,7 +151,7 @@ class Laser(serial_device.Tool):
         ...
 
     @abstractmethod
-    def apply_configuration(self) -> None:
+    def apply_configuration(self) -> serial_device.Transaction:
         ...
 
 
@@ -178,7 +178,8 @@ class LowPowerLaser(Laser):
     @override
     def enabled(self, enabled: bool) -> None:
         self._enable.value = enabled
-        self._driver.write(self._enable)
+        # Disabling is safety critical and jumps the queue.
+        self._driver.write(self._enable, priority=not enabled)
 
     def initialize(self) -> None:
         self._init.value = True
@@ -186,10 +187,12 @@ class LowPowerLaser(Laser):
         self._driver.write(self._init)
 
     @override
-    def apply_configuration(self) -> None:
-        self.set_mode()
-        self.set_current()
-        self.set_photo_diode_gain()
+    def apply_configuration(self) -> serial_device.Transaction:
+        with self._configuration_transaction("mode", "_set_digpot", "photo_diode_gain") as transaction:
+            self.set_mode()
+            self.set_current()
+            self.set_photo_diode_gain()
+        return transaction
 
     def set_mode(self) -> None:
         if self.configuration.mode.constant_light:
@@ -246,14 +249,17 @@ class HighPowerLaser(Laser):
     @enabled.setter
     def enabled(self, enabled: bool) -> None:
         self._enable.value = enabled
-        self._driver.write(self._enable)
+        # Disabling is safety critical and jumps the queue.
+        self._driver.write(self._enable, priority=not enabled)
 
     @override
-    def apply_configuration(self) -> None:
-        self.set_dac(0)
-        self.set_dac(1)
-        self.set_voltage()
-        self.set_dac_matrix()
+    def apply_configuration(self) -> serial_device.Transaction:
+        with self._configuration_transaction("_set_dac", "_set_voltage", "_control_register") as transaction:
+            self.set_dac(0)
+            self.set_dac(1)
+            self.set_voltage()
+            self.set_dac_matrix()
+        return transaction
 
     def set_voltage(self) -> None:
         self._set_voltage.value = self.configuration.bit_value
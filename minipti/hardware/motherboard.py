@@ -12,6 +12,7 @@ import numpy as np
 from fastcrc import crc16
 from overrides import override
 
+from minipti import algorithm
 from . import protocolls
 from . import serial_device
 
@@ -159,7 +160,7 @@ class BMS(serial_device.Tool):
         return self._data.empty()
 
     def do_shutdown(self) -> None:
-        self._driver.write(self._do_shutdown)
+        self._driver.write(self._do_shutdown, priority=True)
 
     @override
     def load_configuration(self) -> bool:
@@ -195,13 +196,15 @@ class Pump(serial_device.Tool):
 
     def disable_pump(self) -> None:
         self._duty_cycle_command.value = 0
-        self.driver.write(self._duty_cycle_command)
+        self.driver.write(self._duty_cycle_command, priority=True)
 
 
 @dataclass
 class DAQConfiguration(serial_device.Config):
     number_of_samples: int
-    ref_period: int
+    ref_period: int  # Samples
+    sample_rate: int = 8000  # Hz
+    samples_per_frame: int = 128
 
 
 @dataclass
@@ -212,11 +215,11 @@ class DAQData:
 
 
 class DAQ(serial_device.Tool):
-    PACKAGE_SIZE: Final = 4104
     _SEQUENCE_SIZE: Final = 8
-    RAW_DATA_SIZE: Final = PACKAGE_SIZE - _SEQUENCE_SIZE
-    _WORD_SIZE: Final = 32
-    ENCODED_DATA_SIZE = RAW_DATA_SIZE // _WORD_SIZE
+    _WORD_SIZE: Final = 32  # Hex digits of one sample of every channel
+    # Frame geometry of the firmware at 8 kHz, the configured one is used once it is loaded.
+    ENCODED_DATA_SIZE: Final = 128
+    PACKAGE_SIZE: Final = _SEQUENCE_SIZE + ENCODED_DATA_SIZE * _WORD_SIZE
     _AC_CHANNELS: Final = 3
     _DC_CHANNELS: Final = 4
 
@@ -251,23 +254,40 @@ class DAQ(serial_device.Tool):
     def samples_buffer_size(self) -> int:
         return len(self.samples_buffer.ref_signal)
 
+    @property
+    def sample_rate(self) -> int:
+        return self.configuration.sample_rate
+
+    @property
+    def ref_period(self) -> int:
+        return self.configuration.ref_period
+
+    @property
+    def samples_per_frame(self) -> int:
+        return self.configuration.samples_per_frame
+
+    @property
+    def package_size(self) -> int:
+        return DAQ._SEQUENCE_SIZE + self.samples_per_frame * DAQ._WORD_SIZE
+
     @property
     def number_of_samples(self) -> int:
         return self.configuration.number_of_samples
 
     @number_of_samples.setter
     def number_of_samples(self, number_of_samples: int) -> None:
+        # Takes effect with the next package, already buffered samples are kept.
         self.configuration.number_of_samples = number_of_samples
-        self.update_buffer_size()
 
     def update_buffer_size(self) -> None:
         self.samples_buffer = DAQData([], [[], [], []], [[], [], [], []])
         self.reset()
 
-    def build_sample_package(self) -> None:
+    def build_sample_package(self, number_of_samples: int) -> bool:
         """
-        Creates a package of samples that represents approximately 1 s data. It contains 8000
-        samples.
+        Creates a package of number_of_samples samples, sample_rate samples represent 1 s of data.
+        Returns:
+            False if the buffer was not synchronous with the reference and has been discarded.
         """
         ref_begin = itertools.islice(
             self.samples_buffer.ref_signal,
@@ -276,18 +296,17 @@ class DAQ(serial_device.Tool):
         if sum(ref_begin):
             logging.warning("Not synchron with reference signal")
             self.reset()
-            return
-        ref = []
-        dc_package = [[], [], []]
-        ac_package = [[], [], []]
-        for _ in itertools.repeat(None, self.number_of_samples):
-            ref.append(self.samples_buffer.ref_signal.pop(0))
-            for channel in range(3):
-                dc_package[channel].append(self.samples_buffer.dc_coupled[channel].pop(0))
-                ac_package[channel].append(self.samples_buffer.ac_coupled[channel].pop(0))
+            return False
+        ref = self.samples_buffer.ref_signal[:number_of_samples]
+        dc_package = [self.samples_buffer.dc_coupled[channel][:number_of_samples] for channel in range(3)]
+        ac_package = [self.samples_buffer.ac_coupled[channel][:number_of_samples] for channel in range(3)]
+        del self.samples_buffer.ref_signal[:number_of_samples]
+        for channel in self.samples_buffer.dc_coupled + self.samples_buffer.ac_coupled:
+            del channel[:number_of_samples]
         self.data[PackageIndex.REF].put(np.array(ref), block=False)
         self.data[PackageIndex.DC].put(np.array(dc_package), block=False)
         self.data[PackageIndex.AC].put(np.array(ac_package), block=False)
+        return True
 
     def _encode_binary(self, raw_data: str) -> None:
         """
@@ -297,20 +316,12 @@ class DAQ(serial_device.Tool):
         repeats periodically. It starts with below the first 10 bytes (meta information) and ends
         before the last 4 bytes (crc checksum).
         """
-        for i in range(0, len(raw_data), DAQ._WORD_SIZE):
-            self.encoded_buffer.ref_signal.append(int(raw_data[i:i + 4], base=16))
-            # AC signed
-            ac_value = Driver.binary_to_2_complement(int(raw_data[i + 4:i + 8], base=16), 16)
-            self.encoded_buffer.ac_coupled[0].append(ac_value)
-            ac_value = Driver.binary_to_2_complement(int(raw_data[i + 8:i + 12], base=16), 16)
-            self.encoded_buffer.ac_coupled[1].append(ac_value)
-            ac_value = Driver.binary_to_2_complement(int(raw_data[i + 12:i + 16], base=16), 16)
-            self.encoded_buffer.ac_coupled[2].append(ac_value)
-            # DC unsigned
-            self.encoded_buffer.dc_coupled[0].append(int(raw_data[i + 16:i + 20], base=16))
-            self.encoded_buffer.dc_coupled[1].append(int(raw_data[i + 20:i + 24], base=16))
-            self.encoded_buffer.dc_coupled[2].append(int(raw_data[i + 24:i + 28], base=16))
-            self.encoded_buffer.dc_coupled[3].append(int(raw_data[i + 28:i + 32], base=16))
+        ref, ac, dc = algorithm.backend.get("daq_decode")(raw_data)
+        self.encoded_buffer.ref_signal.extend(ref.tolist())
+        for channel in range(DAQ._AC_CHANNELS):
+            self.encoded_buffer.ac_coupled[channel].extend(ac[channel].tolist())
+        for channel in range(DAQ._DC_CHANNELS):
+            self.encoded_buffer.dc_coupled[channel].extend(dc[channel].tolist())
 
     def encode(self, data: str) -> None:
         """
@@ -332,8 +343,12 @@ class DAQ(serial_device.Tool):
             self.samples_buffer.dc_coupled[i].extend(self.encoded_buffer.dc_coupled[i])
             self.samples_buffer.ac_coupled[i].extend(self.encoded_buffer.ac_coupled[i])
         self.samples_buffer.dc_coupled[3].extend(self.encoded_buffer.dc_coupled[3])
-        if len(self.samples_buffer.ref_signal) >= self.number_of_samples:
-            self.build_sample_package()
+        # The number of samples may change between two packages, so it is read once per package.
+        number_of_samples = self.number_of_samples
+        while len(self.samples_buffer.ref_signal) >= number_of_samples:
+            if not self.build_sample_package(number_of_samples):
+                break
+            number_of_samples = self.number_of_samples
 
     def synchronize_with_ref(self) -> None:
         """
@@ -341,24 +356,30 @@ class DAQ(serial_device.Tool):
         index after this edge is the first zero and will be by garuantee a sequence of 0es.
         """
         logging.warning("Trying to synchronise")
-        falling_edge = np.where(np.diff(self.encoded_buffer.ref_signal) == -1)[0][0]
+        falling_edges = np.where(np.diff(self.encoded_buffer.ref_signal) == -1)[0]
+        if not falling_edges.size:
+            # A frame can be shorter than half of the reference period at higher sample rates.
+            self.encoded_buffer.ref_signal.clear()
+            for channel in self.encoded_buffer.ac_coupled + self.encoded_buffer.dc_coupled:
+                channel.clear()
+            return
+        falling_edge = falling_edges[0]
         for _ in range(falling_edge + 1):
             self.encoded_buffer.ref_signal.popleft()
             for channel in range(3):
                 self.encoded_buffer.ac_coupled[channel].popleft()
                 self.encoded_buffer.dc_coupled[channel].popleft()
             self.encoded_buffer.dc_coupled[3].popleft()
-        if len(self.encoded_buffer.ref_signal) < self.configuration.ref_period // 2:
-            return
+        # The low half period may continue in the next frames, the package starts at the edge anyway.
         self.synchronize = False
 
     def reset(self) -> None:
         self._sample_numbers = deque(maxlen=2)
         self.synchronize = True
         self.encoded_buffer = DAQData(
-            deque(maxlen=DAQ.ENCODED_DATA_SIZE),
-            [deque(maxlen=DAQ.ENCODED_DATA_SIZE) for _ in range(3)],
-            [deque(maxlen=DAQ.ENCODED_DATA_SIZE) for _ in range(4)]
+            deque(maxlen=self.samples_per_frame),
+            [deque(maxlen=self.samples_per_frame) for _ in range(3)],
+            [deque(maxlen=self.samples_per_frame) for _ in range(4)]
         )
         self.samples_buffer = DAQData([], [[], [], []], [[], [], [], []])
 
@@ -405,6 +426,7 @@ class Driver(serial_device.Driver):
         self.valve = Valve(self)
         self.pump = Pump(self)
         self.new_run = True
+        self._daq_lock = threading.Lock()
 
     @property
     def device_id(self) -> bytes:
@@ -414,6 +436,12 @@ class Driver(serial_device.Driver):
     def device_name(self) -> str:
         return Driver.NAME
 
+    @property
+    @override
+    def max_package_size(self) -> int:
+        # Larger frames of faster DAQ firmware must not be discarded before their termination arrives.
+        return max(super().max_package_size, 2 * self.daq.package_size)
+
     @property
     def buffer_size(self) -> int:
         return len(self._package_buffer)
@@ -425,8 +453,18 @@ class Driver(serial_device.Driver):
         super().clear()
 
     def clear_buffer(self) -> None:
-        self._package_buffer = ""
-        self.daq.data = [queue.Queue(maxsize=Driver._QUEUE_SIZE) for _ in range(3)]
+        with self._package_lock:
+            self._package_buffer = ""
+            self._drain_queues()
+
+    def _drain_queues(self) -> None:
+        # The queues are drained instead of replaced, a consumer may already wait on them.
+        for package in self.daq.data:
+            while True:
+                try:
+                    package.get(block=False)
+                except queue.Empty:
+                    break
 
     @staticmethod
     def binary_to_2_complement(number: int, byte_length: int = 16) -> int:
@@ -435,15 +473,20 @@ class Driver(serial_device.Driver):
         return number
 
     def reset(self) -> None:
-        self.clear_buffer()
-        self.daq.reset()
+        # Called by the GUI thread before a new run, while the processing thread may be encoding.
+        # The order of the locks is the one of encode_data, which takes the DAQ lock within the package lock.
+        with self._package_lock, self._daq_lock:
+            self._package_buffer = ""
+            self._drain_queues()
+            self.daq.reset()
 
     @override
     def _encode(self, data: str) -> None:
-        if self.daq.running.is_set() and data[0] == "D" and len(data) == DAQ.PACKAGE_SIZE + Driver.CRC_SIZE + 1:
+        if self.daq.running.is_set() and data[0] == "D" and len(data) == self.daq.package_size + Driver.CRC_SIZE + 1:
             if not self._crc_check(data, "DAQ"):
                 return
-            self.daq.encode(data[1:-Driver._CRC_START])
+            with self._daq_lock:
+                self.daq.encode(data[1:-Driver._CRC_START])
         elif self.bms.running.is_set() and data[0] == "B" and len(data) == BMS.PACKAGE_SIZE + 1:
             if not self._crc_check(data, "BMS"):
                 return
@@ -463,7 +506,7 @@ class Driver(serial_device.Driver):
 
     def _process_data(self) -> None:
         self.daq.reset()
-        self._package_buffer = ""
+        self.clear_buffer()
         while self.connected.is_set():
             if self.new_run:
                 self.reset()
@@ -1,9 +1,9 @@
+import functools
 import re
 from abc import abstractmethod, ABC
 from dataclasses import dataclass
 from typing import Final, NoReturn
 
-import dacite
 from overrides import override
 
 
@@ -35,6 +35,32 @@ class CommandKeyValue:
     index: str | None = None
 
 
+@dataclass(frozen=True)
+class MultimapTemplate:
+    """
+    A precompiled command of the form key:value or key:[index,value]. Templates are interned per
+    key and index, so formatting a new value neither needs a regex match nor a dacite conversion.
+    """
+    key: str
+    index: int | None = None
+
+    def format(self, value: float | str) -> str:
+        if self.index is None:
+            return f"{self.key}:{value}"
+        return f"{self.key}:[{self.index},{value}]"
+
+
+@functools.lru_cache(maxsize=None)
+def multimap_template(key: str, index: int | None = None) -> MultimapTemplate:
+    """
+    Returns the interned template for key and index. The key is validated only once, when the
+    template is compiled for the first time.
+    """
+    template = MultimapTemplate(key, index)
+    ASCIIMultimap.parse(template.format(0) + "\n")
+    return template
+
+
 class ASCIIMultimap(ASCIIProtocol):
     _STREAM_PATTERNS: Final = [re.compile(r"(?P<key>(Set|Get|Do)\w+):(?P<value>([+-]?([0-9]*[.])?[0-9]?|\w+))\n",
                                           flags=re.MULTILINE),
@@ -52,16 +78,18 @@ class ASCIIMultimap(ASCIIProtocol):
         if stream is not None:
             if key is not None or index is not None or value is not None:
                 raise RuntimeWarning("Other parameters wont be used")
+            ASCIIProtocol.__init__(self, stream)
+            self._command: CommandKeyValue = CommandKeyValue(**self.check_valid_command())
         elif key is not None and value is not None:
-            if index is not None:
-                stream = f"{key}:[{index},{value}]\n"
-            else:
-                stream = f"{key}:{value}\n"
+            template = multimap_template(key, index)
+            ASCIIProtocol.__init__(self, template.format(value) + "\n")
+            self._command: CommandKeyValue = CommandKeyValue(
+                key=key,
+                value=str(value),
+                index=None if index is None else str(index)
+            )
         else:
             raise ValueError(fr"Stream is None or key/value is missing")
-        ASCIIProtocol.__init__(self, stream)
-        command = self.check_valid_command()
-        self._command: CommandKeyValue = dacite.from_dict(CommandKeyValue, command)
 
     @override
     def __repr__(self) -> str:
@@ -102,17 +130,30 @@ class ASCIIMultimap(ASCIIProtocol):
 
     @stream.setter
     def stream(self, new_stream: str) -> None:
-        self._command = dacite.from_dict(CommandKeyValue, self.check_valid_command())
+        self._command = CommandKeyValue(**ASCIIMultimap.parse(new_stream))
         self._stream = new_stream
 
-    @override
-    def check_valid_command(self) -> dict[str, str] | NoReturn:
+    @staticmethod
+    @functools.lru_cache(maxsize=256)
+    def _parse(stream: str) -> tuple[tuple[str, str | None], ...]:
         for pattern in ASCIIMultimap._STREAM_PATTERNS:
-            split_stream = pattern.fullmatch(self._stream)
+            split_stream = pattern.fullmatch(stream)
             if split_stream is not None:
-                return split_stream.groupdict()
-        else:
-            raise ValueError(f"Command {repr(self._stream)} is not valid")
+                return tuple((key, split_stream.group(key)) for key in ("key", "value", "index")
+                             if key in pattern.groupindex)
+        raise ValueError(f"Command {repr(stream)} is not valid")
+
+    @staticmethod
+    def parse(stream: str) -> dict[str, str] | NoReturn:
+        """
+        Splits a stream into its key, value and index. Streams are mostly acknowledgements that repeat
+        the same few commands, hence the results are cached.
+        """
+        return dict(ASCIIMultimap._parse(stream))
+
+    @override
+    def check_valid_command(self) -> dict[str, str] | NoReturn:
+        return ASCIIMultimap.parse(self._stream)
 
 
 @dataclass
@@ -135,9 +176,7 @@ class ASCIIHex(ASCIIProtocol):
         the command. The values are represented in hex strings.
         """
         ASCIIProtocol.__init__(self, stream)
-        self._command: CommandHex = dacite.from_dict(
-            CommandHex, self.check_valid_command()
-        )
+        self._command: CommandHex = CommandHex(**self.check_valid_command())
 
     @override
     def __repr__(self) -> str:
@@ -148,13 +187,19 @@ class ASCIIHex(ASCIIProtocol):
     def __str__(self) -> str:
         return self._stream
 
-    @override
-    def check_valid_command(self) -> dict[str, str] | NoReturn:
-        split_stream = ASCIIHex._STREAM_PATTERN.fullmatch(self._stream)
+    @staticmethod
+    @functools.lru_cache(maxsize=256)
+    def _parse(stream: str) -> tuple[str, str]:
+        split_stream = ASCIIHex._STREAM_PATTERN.fullmatch(stream)
         if split_stream is not None:
-            return split_stream.groupdict()
+            return split_stream.group("command"), split_stream.group("value")
         else:
-            raise ValueError(f"Stream {self._stream} is not valid")
+            raise ValueError(f"Stream {stream} is not valid")
+
+    @override
+    def check_valid_command(self) -> dict[str, str] | NoReturn:
+        command, value = ASCIIHex._parse(self._stream)
+        return {"command": command, "value": value}
 
     @property
     def command(self) -> str:
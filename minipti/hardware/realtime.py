@@ -0,0 +1,118 @@
+"""
+Real-time scheduling of the acquisition threads on Linux.
+
+A thread applies a profile to itself when it starts: it is pinned to the given CPUs, scheduled
+with SCHED_FIFO at the given priority and, if that is not permitted, with the given nice value.
+Every step which is not permitted (missing CAP_SYS_NICE, CAP_IPC_LOCK or the corresponding
+rlimits) or not available on the system is skipped with a warning, the thread then runs with
+normal scheduling.
+
+Locking the memory is opt-in, process wide and done once. It keeps the pages mapped at that time,
+e.g. of the interpreter and the buffers allocated so far, from being swapped out. Later mappings
+are not locked (no MCL_FUTURE): the history of the plots spills old chunks into memory mapped
+files and h5py maps the HDF5 files, locking these would keep them in RAM and make allocations
+fail at RLIMIT_MEMLOCK. Files which are already mapped when the memory is locked are locked as
+well, hence it should only be enabled before long measurements have been recorded.
+
+Python threads still share the GIL, so the profile shortens the time until a thread is woken up
+by the kernel, not the time until it gets the GIL from a busy thread.
+"""
+import ctypes
+import ctypes.util
+import logging
+import os
+import threading
+from dataclasses import dataclass, field
+from typing import Final
+
+
+@dataclass(frozen=True)
+class Profile:
+    cpus: list[int] = field(default_factory=list)  # Empty for all CPUs
+    fifo_priority: int = 10  # 1 - 99, 0 to not use SCHED_FIFO
+    nice: int = -10  # Fallback without SCHED_FIFO, 0 to keep the default
+    lock_memory: bool = False  # See the module documentation
+
+
+@dataclass(frozen=True)
+class Applied:
+    affinity: bool = False
+    fifo: bool = False
+    nice: bool = False
+    memory_locked: bool = False
+
+    def __str__(self) -> str:
+        applied = [name for name, value in vars(self).items() if value]
+        return ", ".join(applied) if applied else "none"
+
+
+_MCL_CURRENT: Final = 1
+
+_memory_lock = threading.Lock()
+_memory_locked: bool | None = None  # None if not tried yet
+
+
+def _set_affinity(cpus: list[int]) -> bool:
+    if not cpus:
+        return False
+    try:
+        os.sched_setaffinity(0, cpus)
+    except (AttributeError, OSError) as error:
+        logging.warning("Could not pin %s to the CPUs %s: %s", threading.current_thread().name, cpus, error)
+        return False
+    return True
+
+
+def _set_fifo(priority: int) -> bool:
+    if priority <= 0 or not hasattr(os, "SCHED_FIFO"):
+        return False
+    try:
+        os.sched_setscheduler(0, os.SCHED_FIFO, os.sched_param(priority))
+    except OSError as error:
+        logging.warning("Could not schedule %s with SCHED_FIFO: %s", threading.current_thread().name, error)
+        return False
+    return True
+
+
+def _set_nice(nice: int) -> bool:
+    if not nice or not hasattr(os, "setpriority"):
+        return False
+    try:
+        # On Linux, the nice value belongs to the thread and not to the process.
+        os.setpriority(os.PRIO_PROCESS, threading.get_native_id(), nice)
+    except OSError as error:
+        logging.warning("Could not set the nice value of %s to %d: %s", threading.current_thread().name, nice,
+                        error)
+        return False
+    return True
+
+
+def _lock_memory() -> bool:
+    global _memory_locked
+    with _memory_lock:
+        if _memory_locked is not None:
+            return _memory_locked
+        _memory_locked = False
+        library = ctypes.util.find_library("c")
+        if library is None:
+            logging.warning("Memory is not locked, locking is not available")
+            return False
+        libc = ctypes.CDLL(library, use_errno=True)
+        if libc.mlockall(_MCL_CURRENT):
+            logging.warning("Could not lock the memory: %s", os.strerror(ctypes.get_errno()))
+            return False
+        _memory_locked = True
+        logging.info("Locked the currently mapped memory of the process")
+        return True
+
+
+def apply(profile: Profile) -> Applied:
+    """
+    Applies the profile to the calling thread.
+    """
+    fifo = _set_fifo(profile.fifo_priority)
+    applied = Applied(affinity=_set_affinity(profile.cpus), fifo=fifo, nice=not fifo and _set_nice(profile.nice),
+                      memory_locked=profile.lock_memory and _lock_memory())
+    logging.info("Real-time profile of %s: %s", threading.current_thread().name, applied)
+    return applied
+
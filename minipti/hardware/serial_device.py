@@ -1,4 +1,6 @@
 import atexit
+import contextlib
+import copy
 import dataclasses
 import functools
 import itertools
@@ -11,13 +13,18 @@ import queue
 import re
 import threading
 import time
+import typing
 from abc import abstractmethod, ABC
+from collections import deque
+from collections.abc import Generator
 from dataclasses import dataclass
 from enum import Enum
-from typing import Type
+from typing import Callable, Final, Type
 import inspect
 
 import dacite
+import numpy as np
+import pandas as pd
 from overrides import final
 
 if platform.system() == "Windows":
@@ -28,7 +35,180 @@ else:
 import serial
 from serial.tools import list_ports
 
-from . import protocolls, _json_parser
+from . import protocolls, realtime, _json_parser
+
+
+class Transaction:
+    """
+    A batch of commands that is written as one unit. The commands are transferred in order, each
+    one waiting for its acknowledgement. The first failed or missing acknowledgement aborts the
+    remaining commands, the transaction is marked as failed and the rollback is called, so that
+    cached state (e.g. configurations) can be restored. A succeeded transaction calls the commit.
+    The done callbacks are called with the completed transaction, on the writer thread.
+    """
+    def __init__(self, rollback: Callable[[], None] | None = None, commit: Callable[[], None] | None = None):
+        self.commands: list[str] = []
+        self._rollback = rollback
+        self._commit = commit
+        self._done = threading.Event()
+        self._callbacks: list[Callable[["Transaction"], None]] = []
+        self._callback_lock = threading.Lock()
+        self.succeeded = False
+        self.discarded = False
+
+    def __repr__(self) -> str:
+        return f"Transaction(commands={self.commands}, done={self.done}, succeeded={self.succeeded})"
+
+    @property
+    def done(self) -> bool:
+        return self._done.is_set()
+
+    def wait(self, timeout: float | None = None) -> bool:
+        """
+        Blocks until the transaction is completed and returns if it succeeded.
+        """
+        self._done.wait(timeout)
+        return self.succeeded
+
+    def discard(self) -> None:
+        """
+        Completes the transaction as failed without any command being written.
+        """
+        self.succeeded = False
+        self.discarded = True
+        self._finish()
+
+    def complete(self, succeeded: bool) -> None:
+        self.succeeded = succeeded
+        if not succeeded and self._rollback is not None:
+            self._rollback()
+        elif succeeded and self._commit is not None:
+            self._commit()
+        self._finish()
+
+    def add_done_callback(self, callback: Callable[["Transaction"], None]) -> None:
+        """
+        Calls the callback when the transaction is completed, immediately if it already is.
+        """
+        with self._callback_lock:
+            if not self.done:
+                self._callbacks.append(callback)
+                return
+        self._call(callback)
+
+    def _finish(self) -> None:
+        with self._callback_lock:
+            self._done.set()
+            callbacks, self._callbacks = self._callbacks, []
+        for callback in callbacks:
+            self._call(callback)
+
+    def _call(self, callback: Callable[["Transaction"], None]) -> None:
+        try:
+            callback(self)
+        except Exception:  # The writer thread has to keep running
+            logging.exception("Callback of %s failed", self)
+
+
+@dataclass
+class _CommandStatistic:
+    histogram: np.ndarray
+    recent: deque
+    acknowledged: int = 0
+    failed: int = 0
+    timeouts: int = 0
+
+
+class CommandLatency:
+    """
+    Round trip times of the written commands per command key, from the transfer of a command until
+    its acknowledgement. The histograms cover the whole connection, the rolling statistics the last
+    RECENT round trips of every key. Commands without acknowledgement within the response time are
+    counted as timeouts, negative acknowledgements as failed.
+    """
+    BIN_EDGES: Final = np.geomspace(1e-4, 1, 41)  # s, 10 bins per decade
+    RECENT: Final = 100
+
+    def __init__(self):
+        self._lock = threading.Lock()
+        self._statistics: dict[str, _CommandStatistic] = {}
+        self._pending: tuple[str, float] | None = None
+
+    @staticmethod
+    def key(command: str) -> str:
+        """
+        The key of a multimap command (SetPID_KP:[0,1]) or the command of a hex command (SHD0001).
+        """
+        key, separator, _ = command.partition(":")
+        return key if separator else command[:3]
+
+    def _statistic(self, key: str) -> _CommandStatistic:
+        if key not in self._statistics:
+            self._statistics[key] = _CommandStatistic(np.zeros(len(CommandLatency.BIN_EDGES) + 1, dtype=int),
+                                                      deque(maxlen=CommandLatency.RECENT))
+        return self._statistics[key]
+
+    def sent(self, command: str) -> None:
+        with self._lock:
+            self._pending = CommandLatency.key(command), time.perf_counter()
+
+    def acknowledged(self, success: bool) -> None:
+        with self._lock:
+            if self._pending is None:  # Late acknowledgement of a timed out command
+                return
+            key, start = self._pending
+            self._pending = None
+            round_trip = time.perf_counter() - start
+            statistic = self._statistic(key)
+            statistic.histogram[np.searchsorted(CommandLatency.BIN_EDGES, round_trip)] += 1
+            statistic.recent.append(round_trip)
+            if success:
+                statistic.acknowledged += 1
+            else:
+                statistic.failed += 1
+
+    def timed_out(self) -> None:
+        with self._lock:
+            if self._pending is not None:
+                self._statistic(self._pending[0]).timeouts += 1
+                self._pending = None
+
+    def clear(self) -> None:
+        with self._lock:
+            self._statistics.clear()
+            self._pending = None
+
+    def summary(self) -> pd.DataFrame:
+        """
+        Counts of every key and the percentiles of its recent round trips in ms.
+        """
+        rows = {}
+        with self._lock:
+            for key, statistic in sorted(self._statistics.items()):
+                recent = np.array(statistic.recent) * 1e3
+                p50, p95 = np.percentile(recent, [50, 95]) if recent.size else (np.nan, np.nan)
+                rows[key] = {"Acknowledged": statistic.acknowledged, "Failed": statistic.failed,
+                             "Timeouts": statistic.timeouts, "P50 [ms]": p50, "P95 [ms]": p95,
+                             "Max [ms]": recent.max() if recent.size else np.nan}
+        return pd.DataFrame.from_dict(rows, orient="index",
+                                      columns=["Acknowledged", "Failed", "Timeouts", "P50 [ms]", "P95 [ms]",
+                                               "Max [ms]"])
+
+    def histograms(self) -> pd.DataFrame:
+        """
+        Round trip counts of every key (columns) per bin, indexed by the upper bin edge in ms.
+        """
+        with self._lock:
+            histograms = {key: statistic.histogram.copy() for key, statistic in sorted(self._statistics.items())}
+        upper_edges = np.append(CommandLatency.BIN_EDGES, np.inf) * 1e3
+        return pd.DataFrame(histograms, index=pd.Index(upper_edges, name="Round Trip [ms]"))
+
+    def save(self, file_path: str) -> None:
+        """
+        Writes the summary and the histograms to file_path_Summary.csv and file_path_Histogram.csv.
+        """
+        self.summary().to_csv(f"{file_path}_Summary.csv", index_label="Command")
+        self.histograms().to_csv(f"{file_path}_Histogram.csv")
 
 
 class Driver(ABC):
@@ -44,18 +224,31 @@ class Driver(ABC):
     _TERMINATION_SYMBOL = "\n"
     _START_DATA_FRAME = 1
     _IO_BUFFER_SIZE = 8000
+    _MAX_PACKAGE_SIZE = 2 * _IO_BUFFER_SIZE
     _SEARCH_ATTEMPTS = 3
+    _MAX_PREEMPTED = 8
 
     def __init__(self):
         self._is_found = False
         self._port_name = ""
         self._package_buffer = ""
+        self._package_lock = threading.Lock()  # Unterminated data, encoded by the processing thread, cleared by others
         self._ready_write = threading.Event()
         self.received_data = queue.Queue(maxsize=Driver._QUEUE_SIZE)
         self._ready_write.set()
-        self.last_written_message = ""
+        self._message_lock = threading.Lock()
+        self._last_written_message = ""
+        self._acknowledged = False
+        self._awaiting_acknowledgement = False
+        self._preempted: deque[str] = deque(maxlen=Driver._MAX_PREEMPTED)
+        self._open_transaction = threading.local()
+        self.command_latency = CommandLatency()
+        self.realtime: realtime.Profile | None = None  # Applied to the receive and processing thread
         self.data = queue.Queue(maxsize=Driver._QUEUE_SIZE)
         self._write_buffer = queue.Queue(maxsize=Driver._QUEUE_SIZE)
+        self._priority_buffer = queue.Queue(maxsize=Driver._QUEUE_SIZE)
+        self._queued_writes = threading.Semaphore(0)
+        self._buffer_lock = threading.Lock()
         if platform.system() == "Windows":
             self._serial_port = System.IO.Ports.SerialPort()
         else:
@@ -64,9 +257,16 @@ class Driver(ABC):
         self._sampling = threading.Event()
         atexit.register(self.clear)
 
+    @property
+    def last_written_message(self) -> str:
+        """
+        Written by the write thread, which together with the acknowledgement state takes the message lock.
+        """
+        return self._last_written_message
+
     @property
     def write_buffer_size(self) -> int:
-        return self._write_buffer.qsize()
+        return self._write_buffer.qsize() + self._priority_buffer.qsize()
 
     def clear(self) -> None:
         time.sleep(0.1)
@@ -171,8 +371,13 @@ class Driver(ABC):
     @final
     def _clear(self) -> None:
         self._write_buffer = queue.Queue()
-        self.last_written_message = ""
+        self._priority_buffer = queue.Queue()
+        self._queued_writes = threading.Semaphore(0)
+        self._awaiting_acknowledgement = False
+        self._preempted.clear()
+        self._last_written_message = ""
         self.received_data = queue.Queue()
+        self.command_latency.clear()
         self._ready_write.set()
 
     if platform.system() == "Windows":
@@ -226,8 +431,16 @@ class Driver(ABC):
     def run(self) -> None:
         threading.Thread(target=self._write, name=f"{self.device_name} Write Thread", daemon=True).start()
         if platform.system() != "Windows":
-            threading.Thread(target=self._receive, name=f"{self.device_name} Receive Thread", daemon=True).start()
-        threading.Thread(target=self._process_data, name=f"{self.device_name} Processing Thread", daemon=True).start()
+            threading.Thread(target=self._run_realtime, args=(self._receive,),
+                             name=f"{self.device_name} Receive Thread", daemon=True).start()
+        threading.Thread(target=self._run_realtime, args=(self._process_data,),
+                         name=f"{self.device_name} Processing Thread", daemon=True).start()
+
+    @final
+    def _run_realtime(self, loop: Callable[[], None]) -> None:
+        if self.realtime is not None:
+            realtime.apply(self.realtime)
+        loop()
 
     @final
     def get_hardware_id(self) -> bytes | None:
@@ -240,43 +453,186 @@ class Driver(ABC):
             hardware_id = hardware_id.group()
             return Patterns.HEX_VALUE.search(hardware_id).group()
 
-    @functools.singledispatchmethod
     @final
-    def write(self, message: str) -> bool:
+    @contextlib.contextmanager
+    def transaction(self, rollback: Callable[[], None] | None = None,
+                    commit: Callable[[], None] | None = None) -> Generator[Transaction, None, None]:
+        """
+        Collects every command written inside the with block of the calling thread and queues them
+        as one transaction when the block is left. If the device is not connected nothing is
+        written and the transaction is failed without rollback.
+        """
+        transaction = Transaction(rollback, commit)
+        self._open_transaction.current = transaction
+        try:
+            yield transaction
+        finally:
+            self._open_transaction.current = None
+        if self.connected.is_set() and transaction.commands:
+            self._enqueue(transaction)
+        else:
+            transaction.discard()
+
+    @final
+    def _enqueue(self, message: str | Transaction, priority: bool = False) -> None:
+        with self._buffer_lock:
+            if priority:
+                self._discard_superseded(message)
+                self._priority_buffer.put(message, block=False)
+                # Pre-empts the wait for the acknowledgement of the outstanding command.
+                self._ready_write.set()
+            else:
+                self._write_buffer.put(message, block=False)
+            self._queued_writes.release()
+
+    @final
+    def _discard_superseded(self, message: str) -> None:
+        """
+        Removes the queued commands and transactions which set the same as the priority command,
+        e.g. an enable queued before a disable, so they are not written after it.
+        """
+        key = CommandLatency.key(message)
+        kept = []
+        while True:
+            try:
+                queued: str | Transaction = self._write_buffer.get(block=False)
+            except queue.Empty:
+                break
+            commands = queued.commands if isinstance(queued, Transaction) else [queued]
+            if not any(CommandLatency.key(command) == key for command in commands):
+                kept.append(queued)
+                continue
+            logging.warning("Discarded %s on %s, superseded by %s", queued, self.device_name, message)
+            if isinstance(queued, Transaction):
+                queued.complete(succeeded=False)
+            # If the write thread already holds the permit, it finds the buffers empty and waits again.
+            self._queued_writes.acquire(blocking=False)
+        for queued in kept:
+            self._write_buffer.put(queued, block=False)
+
+    @final
+    def _put(self, message: str, priority: bool = False) -> bool:
+        """
+        Priority commands are not part of an open transaction. They are written before every queued
+        command and transaction, without waiting for the acknowledgement of the outstanding one.
+        """
+        transaction: Transaction | None = getattr(self._open_transaction, "current", None)
+        if transaction is not None and not priority:
+            transaction.commands.append(message)
+            return True
         if self.connected.is_set():
-            self._write_buffer.put(message, block=False)
+            self._enqueue(message, priority)
             return True
         return False
 
+    @functools.singledispatchmethod
+    @final
+    def write(self, message: str, priority: bool = False) -> bool:
+        return self._put(message, priority)
+
     @write.register(protocolls.ASCIIProtocol)
     @final
-    def _(self, message: protocolls.ASCIIProtocol) -> bool:
-        if self.connected.is_set():
-            self._write_buffer.put(str(message), block=False)
-            return True
-        return False
+    def _(self, message: protocolls.ASCIIProtocol, priority: bool = False) -> bool:
+        return self._put(str(message), priority)
 
     @write.register(bytes)
     @write.register(bytearray)
     @final
-    def _(self, message: bytes | bytearray) -> bool:
-        if self.connected.is_set():
-            self._write_buffer.put(message.decode(), block=False)
-            return True
+    def _(self, message: bytes | bytearray, priority: bool = False) -> bool:
+        return self._put(message.decode(), priority)
+
+    @final
+    def _next_message(self) -> str | Transaction:
+        while True:
+            self._queued_writes.acquire()
+            with self._buffer_lock:
+                for buffer in self._priority_buffer, self._write_buffer:
+                    try:
+                        return buffer.get(block=False)
+                    except queue.Empty:
+                        continue
+
+    @final
+    def _wait_for_acknowledgement(self) -> bool:
+        """
+        Waits for the acknowledgement of the outstanding command. A missing acknowledgement is
+        counted as timeout. If a priority command pre-empts the wait, the acknowledgement of the
+        outstanding command is discarded when it arrives.
+        Returns:
+            False if the outstanding command was not acknowledged in time or was pre-empted.
+        """
+        acknowledged = self._ready_write.wait(timeout=Driver._MAX_RESPONSE_TIME)
+        self._ready_write.clear()
+        with self._message_lock:
+            # An acknowledgement clears the flag under the lock before it sets the event, so a set
+            # event with the flag still set comes from a priority command.
+            if not self._awaiting_acknowledgement:
+                return acknowledged
+            self._awaiting_acknowledgement = False
+            if acknowledged:
+                outstanding = self._last_written_message[:-1]
+                self._preempted.append(outstanding)
+        if not acknowledged:
+            self.command_latency.timed_out()
+            return False
+        logging.warning("%s pre-empted by a priority command on %s", outstanding, self.device_name)
         return False
 
+    @final
+    def _send(self, message: str) -> None:
+        with self._message_lock:
+            self._last_written_message = message + Driver._TERMINATION_SYMBOL
+            self._acknowledged = False
+            self._awaiting_acknowledgement = True
+            # A late acknowledgement of a pre-empted command may have set the event.
+            self._ready_write.clear()
+        self.command_latency.sent(message)
+        try:
+            self._transfer()
+        except OSError:
+            logging.error("Could not transfer %s to %s", self.last_written_message, self.device_name)
+            raise
+        logging.debug("%s written to %s", message, self.device_name)
+
     @final
     def _write(self) -> None:
         while self.connected.is_set():
-            self._ready_write.wait(timeout=Driver._MAX_RESPONSE_TIME)
-            self._ready_write.clear()
-            self.last_written_message = self._write_buffer.get(block=True) + Driver._TERMINATION_SYMBOL
+            self._wait_for_acknowledgement()
+            message: str | Transaction = self._next_message()
+            try:
+                if isinstance(message, Transaction):
+                    self._write_transaction(message)
+                else:
+                    self._send(message)
+            except OSError:
+                break
+
+    @final
+    def _write_transaction(self, transaction: Transaction) -> None:
+        for command in transaction.commands:
             try:
-                self._transfer()
+                self._send(command)
             except OSError:
-                logging.error("Could not transfer %s to %s", self.last_written_message)
+                transaction.complete(succeeded=False)
+                raise
+            if not self._wait_for_acknowledgement() or not self._acknowledged:
+                logging.error("Transaction aborted at %s on %s", command, self.device_name)
+                transaction.complete(succeeded=False)
                 break
-            logging.debug("%s written to %s", self.last_written_message[:-1], self.device_name)
+        else:
+            transaction.complete(succeeded=True)
+        self._ready_write.set()
+
+    @final
+    def _acknowledge(self, success: bool) -> None:
+        with self._message_lock:
+            awaiting = self._awaiting_acknowledgement
+            self._awaiting_acknowledgement = False
+        if not awaiting:  # Late after a timeout, the event must not release the next command
+            return
+        self.command_latency.acknowledged(success)
+        self._acknowledged = success
+        self._ready_write.set()
 
     @final
     def _transfer(self) -> None:
@@ -285,17 +641,31 @@ class Driver(ABC):
         else:
             os.write(self._file_descriptor, self.last_written_message.encode())
 
+    @final
+    def _discard_preempted(self, data: str) -> bool:
+        """
+        Must be called with the message lock held.
+        """
+        for preempted in self._preempted:
+            if data == preempted or data == preempted.capitalize():
+                self._preempted.remove(preempted)
+                logging.debug("Discarded acknowledgement %s of a pre-empted command", data)
+                return True
+        return False
+
     @final
     def _check_ack(self, data: str) -> bool:
-        last_written = self.last_written_message[:-1]
-        if data != last_written and data != last_written.capitalize():
-            logging.error("Received message %s message, expected  %s", data, self.last_written_message)
-            success = False
-        else:
+        with self._message_lock:
+            last_written = self._last_written_message[:-1]
+            expected = data == last_written or data == last_written.capitalize()
+            if not (expected and self._awaiting_acknowledgement) and self._discard_preempted(data):
+                return True
+        if expected:
             logging.debug("Command %s successfully applied", data)
-            success = True
-        self._ready_write.set()
-        return success
+        else:
+            logging.error("Received message %s message, expected  %s", data, self.last_written_message)
+        self._acknowledge(expected)
+        return expected
 
     if platform.system() == "Windows":
         @property
@@ -382,13 +752,26 @@ class Driver(ABC):
         identifier, to decide the decoding algorithm of it.
         """
         try:
-            received_data: str = self._package_buffer + self.get_data()
+            data = self.get_data()
         except OSError:
             return
-        split_data = received_data.split(Driver._TERMINATION_SYMBOL)
-        for received in split_data[:-1]:
-            self._encode(received)
-        self._package_buffer = split_data[-1]
+        # A clear of the buffer by another thread must not be overwritten with the stale partial package.
+        with self._package_lock:
+            split_data = (self._package_buffer + data).split(Driver._TERMINATION_SYMBOL)
+            for received in split_data[:-1]:
+                self._encode(received)
+            self._package_buffer = split_data[-1]
+            if len(self._package_buffer) > self.max_package_size:
+                logging.error("Discarded %d bytes of %s without termination", len(self._package_buffer),
+                              self.device_name)
+                self._package_buffer = ""
+
+    @property
+    def max_package_size(self) -> int:
+        """
+        Unterminated data beyond this size is discarded.
+        """
+        return Driver._MAX_PACKAGE_SIZE
 
     @abstractmethod
     def _encode(self, data: str) -> None:
@@ -423,6 +806,8 @@ class Tool(ABC):
             file_name = f"{self._config_name.casefold().replace(' ', '_')}.json"
         self.config_path = f"{base_path}/{file_name}"
         self._config_type: Type[Config] = configuration_type
+        # The configuration and command attributes as last acknowledged by the device.
+        self._acknowledged: dict[str, typing.Any] = {}
 
     def load_configuration(self) -> bool:
         try:
@@ -432,6 +817,7 @@ class Tool(ABC):
                     self._config_type,
                     loaded_config[self._config_name]
                 )
+                self._acknowledged = {"configuration": copy.deepcopy(self.configuration)}
                 return True
         except (dacite.DaciteError, json.decoder.JSONDecodeError, FileNotFoundError):
             self.configuration = self._config_type()
@@ -441,6 +827,39 @@ class Tool(ABC):
             )
             return False
 
+    @final
+    @contextlib.contextmanager
+    def _configuration_transaction(self, *attributes: str) -> Generator[Transaction, None, None]:
+        """
+        Opens a transaction of the configuration and the given command attributes. If it succeeds,
+        they become the acknowledged state, if it fails, the last acknowledged state is restored.
+        """
+        for name in ("configuration", *attributes):  # Commands still hold the last written values here
+            self._acknowledged.setdefault(name, copy.deepcopy(getattr(self, name)))
+        applied: dict[str, typing.Any] = {}
+
+        def commit() -> None:
+            self._acknowledged.update(applied)
+
+        def rollback() -> None:
+            for name, value in copy.deepcopy(self._acknowledged).items():
+                setattr(self, name, value)
+
+        with self._driver.transaction(rollback, commit) as transaction:
+            transaction.add_done_callback(self._log_applied)
+            yield transaction
+            applied.update(copy.deepcopy({name: getattr(self, name) for name in ("configuration", *attributes)}))
+
+    def _log_applied(self, transaction: Transaction) -> None:
+        if transaction.succeeded:
+            logging.info("Applied configuration of %s", self._config_name)
+        elif transaction.discarded:
+            logging.info("Configuration of %s is not applied, %s is not connected", self._config_name,
+                         self._driver.device_name)
+        else:
+            logging.error("Could not apply configuration of %s, restored the last acknowledged values",
+                          self._config_name)
+
     @final
     def save_configuration(self) -> None:
         with open(self.config_path, "w") as configuration:
@@ -83,6 +83,7 @@ class Driver(serial_device.Driver):
         if data[0] == "S":
             written = protocolls.ASCIIMultimap(self.last_written_message)
             data = protocolls.ASCIIMultimap(data + "\n")
+            success = False
             if data.key != written.key:
                 logging.error("Received message with as key %s, expected key %s", data.key, data.key)
             elif data.value == "PARAMERROR":
@@ -91,7 +92,8 @@ class Driver(serial_device.Driver):
                 logging.error("Index %s is not valid", written.index)
             else:
                 logging.debug("Command %s successfully applied", data)
-            self._ready_write.set()
+                success = True
+            self._acknowledge(success)
         elif data[0] == "T":
             data_frame: list[str] = data.split("\t")[Driver._START_DATA_FRAME:]
             status_byte_frame = int(data_frame[TecDataIndex.PT1000_STATUS])
@@ -152,13 +154,19 @@ class Tec(serial_device.Tool):
     def set_ntc_dac(self) -> None:
         self.driver.write(self.commands.set_ntc_dac)
 
-    def apply_configuration(self) -> None:
-        self.set_pid_d_gain()
-        self.set_pid_p_gain()
-        self.set_pid_i_gain()
-        self.set_loop_time_ms()
-        self.set_max_power()
-        self.set_setpoint_temperature_value()
+    def apply_configuration(self) -> serial_device.Transaction:
+        """
+        Writes the whole configuration as one transaction. If the TEC Driver rejects any of the
+        commands, the configuration and commands are restored to the last acknowledged state.
+        """
+        with self._configuration_transaction("commands") as transaction:
+            self.set_pid_d_gain()
+            self.set_pid_p_gain()
+            self.set_pid_i_gain()
+            self.set_loop_time_ms()
+            self.set_max_power()
+            self.set_setpoint_temperature_value()
+        return transaction
 
     def set_pid_d_gain(self) -> None:
         self.commands.set_d_gain.value = self.configuration.pid.derivative_value
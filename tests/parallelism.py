@@ -0,0 +1,182 @@
+"""
+Benchmark of the thread parallelism of the live pipeline against the emulated motherboard.
+
+The stages receive (emulated serial data), decode (frame decoding and package assembly), compute
+(decimation, interferometry and inversion) and GUI (snapshots and history envelopes, as the plots
+request them) run once one after another in a single thread and once in one thread per stage,
+connected by the same queues as in the application. The speedup of the threaded run and the CPU
+time of every stage per wall time show how much the stages actually overlap. With the GIL only
+the numpy and numba kernels which release it overlap, on a free-threaded build every stage does.
+
+A short run is done with
+    python -m pytest tests/parallelism.py
+and a longer one with
+    python -m tests.parallelism --seconds 40 --sample-rate 32000
+"""
+import argparse
+import logging
+import os
+import queue
+import sys
+import threading
+import time
+from dataclasses import dataclass, field
+
+import numpy as np
+
+import minipti
+from minipti.gui import model
+from tests.sample_rate import Acquisition
+
+
+def gil_enabled() -> bool:
+    return getattr(sys, "_is_gil_enabled", lambda: True)()
+
+
+@dataclass
+class Timing:
+    wall_time: float = 0  # s
+    cpu_time: dict[str, float] = field(default_factory=dict)  # s per stage
+    packages: int = 0
+
+    @property
+    def parallelism(self) -> float:
+        """
+        Average number of stages running at the same time.
+        """
+        return sum(self.cpu_time.values()) / self.wall_time
+
+    def __str__(self) -> str:
+        stages = ", ".join(f"{stage} {cpu_time / self.wall_time:.0%}" for stage, cpu_time in self.cpu_time.items())
+        return f"{self.packages} packages in {self.wall_time:.2f} s, parallelism {self.parallelism:.2f} ({stages})"
+
+
+class Pipeline:
+    STAGES = ("receive", "decode", "compute", "gui")
+
+    def __init__(self, seconds: int, sample_rate: int = 8000):
+        self.seconds = seconds
+        self.sample_rate = sample_rate
+
+    def _receive(self, acquisition: Acquisition) -> None:
+        acquisition.driver.received_data.put(acquisition.emulator.frames(self.sample_rate))
+
+    @staticmethod
+    def _decode(acquisition: Acquisition) -> None:
+        acquisition.driver.encode_data()
+
+    @staticmethod
+    def _compute(acquisition: Acquisition, interferometer_buffer: model.buffer.Interferometer,
+                 ac: np.ndarray) -> model.buffer.Snapshot:
+        # The AC package is put last, so the others of the same package are already there.
+        data = acquisition.driver.daq.data
+        acquisition.calculate(data[minipti.hardware.motherboard.PackageIndex.REF].get(block=False), ac,
+                              data[minipti.hardware.motherboard.PackageIndex.DC].get(block=False))
+        interferometer_buffer.append(acquisition.interferometer)
+        return interferometer_buffer.snapshot()
+
+    @staticmethod
+    def _gui(snapshot: model.buffer.InterferometerSnapshot) -> None:
+        if not snapshot.valid:
+            return
+        np.nanmax(snapshot.dc_values, axis=1)
+        session = snapshot.source.history_snapshot(-np.inf, np.inf, points=200)
+        np.nanmin(session.interferometric_phase)
+
+    def serial(self) -> Timing:
+        acquisition = Acquisition(self.sample_rate)
+        interferometer_buffer = model.buffer.Interferometer()
+        timing = Timing(cpu_time=dict.fromkeys(Pipeline.STAGES, 0.))
+        ac = acquisition.driver.daq.data[minipti.hardware.motherboard.PackageIndex.AC]
+        start = time.perf_counter()
+        for _ in range(self.seconds + 1):  # The first second is partly lost by synchronising
+            for stage, step in (("receive", lambda: self._receive(acquisition)),
+                                ("decode", lambda: self._decode(acquisition))):
+                cpu_time = time.thread_time()
+                step()
+                timing.cpu_time[stage] += time.thread_time() - cpu_time
+            while not ac.empty():
+                cpu_time = time.thread_time()
+                snapshot = self._compute(acquisition, interferometer_buffer, ac.get(block=False))
+                timing.cpu_time["compute"] += time.thread_time() - cpu_time
+                cpu_time = time.thread_time()
+                self._gui(snapshot)
+                timing.cpu_time["gui"] += time.thread_time() - cpu_time
+                timing.packages += 1
+        timing.wall_time = time.perf_counter() - start
+        acquisition.decimation.live_file.close()
+        return timing
+
+    def threaded(self) -> Timing:
+        acquisition = Acquisition(self.sample_rate)
+        interferometer_buffer = model.buffer.Interferometer()
+        timing = Timing()
+        snapshots = queue.Queue()
+        received = threading.Event()
+        ac = acquisition.driver.daq.data[minipti.hardware.motherboard.PackageIndex.AC]
+
+        def stage(name: str, loop) -> threading.Thread:
+            def run() -> None:
+                loop()
+                timing.cpu_time[name] = time.thread_time()
+
+            return threading.Thread(target=run, name=name, daemon=True)
+
+        def receive() -> None:
+            for _ in range(self.seconds + 1):
+                self._receive(acquisition)
+            received.set()
+
+        def decode() -> None:
+            while not received.is_set() or not acquisition.driver.received_data.empty():
+                self._decode(acquisition)
+            ac.put(None)
+
+        def compute() -> None:
+            while (package := ac.get()) is not None:
+                snapshots.put(self._compute(acquisition, interferometer_buffer, package))
+                timing.packages += 1
+            snapshots.put(None)
+
+        def gui() -> None:
+            while (snapshot := snapshots.get()) is not None:
+                self._gui(snapshot)
+
+        threads = [stage(name, loop) for name, loop in zip(Pipeline.STAGES, (receive, decode, compute, gui))]
+        start = time.perf_counter()
+        for thread in threads:
+            thread.start()
+        for thread in threads:
+            thread.join()
+        timing.wall_time = time.perf_counter() - start
+        acquisition.decimation.live_file.close()
+        return timing
+
+
+def test_parallelism() -> None:
+    pipeline = Pipeline(seconds=4)
+    serial = pipeline.serial()
+    threaded = pipeline.threaded()
+    assert threaded.packages == serial.packages >= 4
+    if not gil_enabled() and os.cpu_count() >= len(Pipeline.STAGES):
+        assert serial.wall_time / threaded.wall_time > 1.5
+
+
+def main() -> int:
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--seconds", type=int, default=20, help="Acquisition time")
+    parser.add_argument("--sample-rate", type=int, default=8000)
+    arguments = parser.parse_args()
+    logging.basicConfig(level=logging.ERROR, format="%(levelname)s %(asctime)s: %(message)s")
+    pipeline = Pipeline(arguments.seconds, arguments.sample_rate)
+    serial = pipeline.serial()
+    threaded = pipeline.threaded()
+    print(f"GIL {'enabled' if gil_enabled() else 'disabled'}, {os.cpu_count()} CPUs")
+    print(f"Serial:   {serial}")
+    print(f"Threaded: {threaded}")
+    print(f"Speedup {serial.wall_time / threaded.wall_time:.2f}")
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
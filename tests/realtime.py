@@ -0,0 +1,154 @@
+"""
+Benchmark of the wake-up jitter of an acquisition thread for the real-time profiles.
+
+A thread wakes up every frame period of the motherboard, as the receive thread does for every
+frame, and measures how late it runs after the deadline. Meanwhile, one busy process per CPU loads
+the system, once alone and once with a thread writing DataFrames, like the GUI and the CSV output,
+which competes for the GIL. The profiles reduce the jitter caused by other processes, but not the
+one caused by waiting for the GIL held by another thread of the application. Every profile is
+applied to a new thread, so the profiles do not influence each other. A step of a profile that is
+not permitted falls back as in the application, so the applied steps are printed with the result.
+
+A short run is done with
+    python -m pytest tests/realtime.py
+and a longer one (with the privileges for SCHED_FIFO, e.g. as root or with CAP_SYS_NICE) with
+    python -m tests.realtime --seconds 30
+"""
+import argparse
+import io
+import logging
+import multiprocessing
+import multiprocessing.synchronize
+import os
+import sys
+import threading
+import time
+from dataclasses import dataclass
+
+import numpy as np
+import pandas as pd
+
+import minipti
+
+PROFILES = {
+    "normal": None,
+    "nice": minipti.hardware.realtime.Profile(fifo_priority=0, lock_memory=False),
+    "fifo": minipti.hardware.realtime.Profile(lock_memory=False),
+    "fifo, pinned": minipti.hardware.realtime.Profile(cpus=[os.cpu_count() - 1], lock_memory=False)
+}
+
+
+@dataclass(frozen=True)
+class Result:
+    profile: str
+    applied: minipti.hardware.realtime.Applied
+    lateness: np.ndarray  # s
+
+    def __str__(self) -> str:
+        percentiles = np.percentile(self.lateness, [50, 99]) * 1e3
+        return f"{self.profile} (applied: {self.applied}): {self.lateness.size} wake-ups, lateness median " \
+               f"{percentiles[0]:.3f} ms, p99 {percentiles[1]:.3f} ms, max {self.lateness.max() * 1e3:.3f} ms"
+
+
+def _busy(stop: multiprocessing.synchronize.Event) -> None:
+    values = np.random.default_rng().random(100_000)
+    while not stop.is_set():
+        np.sort(values)
+
+
+def _write_data_frames(stop: threading.Event) -> None:
+    data_frame = pd.DataFrame(np.random.default_rng().random((1000, 8)))
+    while not stop.is_set():
+        data_frame.to_csv(io.StringIO())
+
+
+class Load:
+    def __init__(self, processes: int = os.cpu_count(), data_frames: bool = True):
+        self._processes = processes
+        self._data_frames = data_frames
+        self._stop_processes = multiprocessing.Event()
+        self._stop_thread = threading.Event()
+        self._workers: list = []
+
+    def __enter__(self) -> "Load":
+        self._workers = [multiprocessing.Process(target=_busy, args=(self._stop_processes,), daemon=True)
+                         for _ in range(self._processes)]
+        if self._data_frames:
+            self._workers.append(threading.Thread(target=_write_data_frames, args=(self._stop_thread,),
+                                                  daemon=True))
+        for worker in self._workers:
+            worker.start()
+        return self
+
+    def __exit__(self, *_) -> None:
+        self._stop_processes.set()
+        self._stop_thread.set()
+        for worker in self._workers:
+            worker.join()
+
+
+def measure(profile: str, seconds: float, period: float) -> Result:
+    results: list[Result] = []
+
+    def wake_up() -> None:
+        settings = PROFILES[profile]
+        applied = minipti.hardware.realtime.Applied() if settings is None else minipti.hardware.realtime.apply(
+            settings)
+        lateness = []
+        deadline = time.monotonic() + period
+        end = deadline + seconds
+        while deadline < end:
+            time.sleep(max(deadline - time.monotonic(), 0))
+            lateness.append(time.monotonic() - deadline)
+            deadline += period
+        results.append(Result(profile, applied, np.array(lateness)))
+
+    thread = threading.Thread(target=wake_up, name=f"Jitter {profile}")
+    thread.start()
+    thread.join()
+    return results[0]
+
+
+def frame_period(sample_rate: int = 8000, samples_per_frame: int = 128) -> float:
+    return samples_per_frame / sample_rate
+
+
+def test_profiles() -> None:
+    with Load(data_frames=False):
+        results = [measure(profile, seconds=0.5, period=frame_period()) for profile in PROFILES]
+    for result in results:
+        assert result.lateness.size > 0
+        assert np.all(result.lateness >= 0)
+        # The nice value is only the fallback for SCHED_FIFO.
+        assert not (result.applied.fifo and result.applied.nice)
+
+
+def test_fallback(monkeypatch) -> None:
+    def not_permitted(*_) -> None:
+        raise PermissionError("Operation not permitted")
+
+    monkeypatch.setattr(os, "sched_setscheduler", not_permitted)
+    monkeypatch.setattr(os, "setpriority", not_permitted)
+    applied = minipti.hardware.realtime.apply(minipti.hardware.realtime.Profile(lock_memory=False))
+    assert applied == minipti.hardware.realtime.Applied()
+
+
+def main() -> int:
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--seconds", type=float, default=30, help="Measuring time per profile")
+    parser.add_argument("--sample-rate", type=int, default=8000)
+    parser.add_argument("--samples-per-frame", type=int, default=128)
+    parser.add_argument("--processes", type=int, default=os.cpu_count(), help="Busy processes loading the system")
+    arguments = parser.parse_args()
+    logging.basicConfig(level=logging.WARNING, format="%(levelname)s %(asctime)s: %(message)s")
+    period = frame_period(arguments.sample_rate, arguments.samples_per_frame)
+    for data_frames in False, True:
+        print(f"Busy processes: {arguments.processes}" + (", thread writing DataFrames" if data_frames else ""))
+        with Load(arguments.processes, data_frames):
+            for profile in PROFILES:
+                print(measure(profile, arguments.seconds, period))
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,149 @@
+"""
+Validation of the configurable DAQ sample rate against the emulated motherboard.
+
+For every sample rate, the emulated frames of some seconds of acquisition run through decoding,
+package assembly, decimation, interferometry, inversion and the live HDF5 output. The reference
+frequency is kept, so the reference period scales with the sample rate. The CPU time per second of
+acquisition gives the headroom of one core, i.e. 1 - CPU time / acquisition time. The headroom
+depends on the machine, hence it is only reported and not asserted.
+
+A short run is done with
+    python -m pytest tests/sample_rate.py
+and a longer one with
+    python -m tests.sample_rate --seconds 60 --sample-rates 8000 16000 32000
+The headroom measured on a reference machine is listed in the README.
+"""
+import argparse
+import dataclasses
+import logging
+import sys
+import tempfile
+import time
+from dataclasses import dataclass
+
+import h5py
+import numpy as np
+import pytest
+
+import minipti
+
+
+@dataclass(frozen=True)
+class Result:
+    sample_rate: int  # Hz
+    samples_per_frame: int
+    seconds: int  # Acquisition time
+    cpu_time: float  # s
+    lock_in_amplitude: np.ndarray  # V
+
+    @property
+    def headroom(self) -> float:
+        return 1 - self.cpu_time / self.seconds
+
+    def __str__(self) -> str:
+        return f"{self.sample_rate / 1000:g} kHz, {self.samples_per_frame} samples per frame: " \
+               f"{self.cpu_time / self.seconds * 1000:.1f} ms CPU per s, headroom {self.headroom:.1%}"
+
+
+class Acquisition:
+    PARAMETER = minipti.algorithm.interferometry.CharacteristicParameter(
+        amplitudes=np.array([1., 0.9, 1.1]),
+        offsets=np.array([1.5, 1.4, 1.6]),
+        output_phases=np.array([0, 2 * np.pi / 3, 4 * np.pi / 3])
+    )
+    REFERENCE_FREQUENCY = 80  # Hz
+    PTI_AMPLITUDE = 1e-4  # V
+
+    def __init__(self, sample_rate: int, samples_per_frame: int = 128, destination_folder: str | None = None):
+        self.sample_rate = sample_rate
+        self.samples_per_frame = samples_per_frame
+        self.ref_period = sample_rate // Acquisition.REFERENCE_FREQUENCY
+        self.destination_folder = tempfile.mkdtemp() if destination_folder is None else destination_folder
+        self.emulator = minipti.hardware.emulator.Motherboard(
+            minipti.hardware.emulator.Interferometer(Acquisition.PARAMETER), ref_period=self.ref_period,
+            pti_amplitude=Acquisition.PTI_AMPLITUDE, sample_rate=sample_rate, samples_per_frame=samples_per_frame
+        )
+        self.driver = minipti.hardware.motherboard.Driver()
+        self.driver.daq.configuration = dataclasses.replace(self.driver.daq.configuration,
+                                                            number_of_samples=sample_rate, ref_period=self.ref_period,
+                                                            sample_rate=sample_rate,
+                                                            samples_per_frame=samples_per_frame)
+        self.driver.reset()
+        self.driver.daq.running.set()
+        self.decimation = minipti.algorithm.pti.Decimation()
+        # The emulated intensity has no noise, the common mode reduction would only distort the PTI signal.
+        self.decimation.use_common_mode_noise_reduction = False
+        self.decimation.configure_acquisition(sample_rate, self.ref_period)
+        self.decimation.destination_folder = self.destination_folder
+        self.decimation.save_raw_data = True
+        self.decimation.live_file = minipti.algorithm.swmr.LiveFile(f"{self.destination_folder}/Live.hdf5",
+                                                                    sample_rate, self.ref_period)
+        self.interferometer = minipti.algorithm.interferometry.Interferometer()
+        self.interferometer.destination_folder = self.destination_folder
+        self.interferometer.load_settings()
+        self.inversion = minipti.algorithm.pti.Inversion(decimation=self.decimation,
+                                                         interferometer=self.interferometer)
+        self.inversion.destination_folder = self.destination_folder
+
+    def _calculate(self) -> None:
+        self.calculate(*(package.get(block=False) for package in self.driver.daq.data))
+
+    def calculate(self, ref: np.ndarray, ac: np.ndarray, dc: np.ndarray) -> None:
+        self.decimation.raw_data.ref, self.decimation.raw_data.ac, self.decimation.raw_data.dc = ref, ac, dc
+        self.decimation.run(live=True)
+        self.interferometer.intensities = self.decimation.dc_signals
+        self.interferometer.run(live=True)
+        self.inversion.run(live=True)
+
+    def run(self, seconds: int) -> Result:
+        # The frames are generated before, so only the processing is measured.
+        frames = [self.emulator.frames(self.sample_rate) for _ in range(seconds + 1)]
+        packages = 0
+        lock_in_amplitude = []
+        start = time.process_time()
+        for second in frames:
+            self.driver.received_data.put(second)
+            self.driver.encode_data()
+            while not self.driver.daq.data[minipti.hardware.motherboard.PackageIndex.AC].empty():
+                self._calculate()
+                packages += 1
+                lock_in_amplitude.append(self.decimation.lock_in.amplitude.copy())
+        cpu_time = time.process_time() - start
+        self.decimation.live_file.close()
+        # The samples lost by synchronising with the reference and the rest of the last second are
+        # decoded but not calculated, so the CPU time per package is slightly overestimated.
+        return Result(self.sample_rate, self.samples_per_frame, packages, cpu_time,
+                      np.mean(lock_in_amplitude, axis=0))
+
+
+@pytest.mark.parametrize("sample_rate, samples_per_frame", [(8000, 128), (16000, 128), (32000, 128), (16000, 256)])
+def test_sample_rate(sample_rate, samples_per_frame, record_property) -> None:
+    acquisition = Acquisition(sample_rate, samples_per_frame)
+    result = acquisition.run(seconds=3)
+    assert result.seconds >= 3
+    # The lock in amplitude of a cosine is half of its amplitude.
+    np.testing.assert_allclose(result.lock_in_amplitude, Acquisition.PTI_AMPLITUDE / 2, rtol=0.05)
+    # The headroom depends on the machine, so it is reported (e.g. with --junitxml) and not asserted.
+    record_property("headroom", result.headroom)
+    logging.info("%s", result)
+    with h5py.File(acquisition.decimation.live_file.file_path, "r") as h5f:
+        assert minipti.algorithm.swmr.acquisition(h5f) == (sample_rate, acquisition.ref_period)
+        assert np.all(np.diff(h5f["Raw/Package"], prepend=0) == sample_rate)
+
+
+def main() -> int:
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--seconds", type=int, default=60, help="Acquisition time per sample rate")
+    parser.add_argument("--sample-rates", type=int, nargs="+", default=[8000, 16000, 32000])
+    parser.add_argument("--samples-per-frame", type=int, default=128)
+    arguments = parser.parse_args()
+    logging.basicConfig(level=logging.WARNING, format="%(levelname)s %(asctime)s: %(message)s")
+    results = [Acquisition(sample_rate, arguments.samples_per_frame).run(arguments.seconds)
+               for sample_rate in arguments.sample_rates]
+    for result in results:
+        print(f"{result}" + ("" if result.headroom > 0 else " (not sustainable on this machine)"))
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,197 @@
+"""
+Soak test of the live calculation against the emulated motherboard in accelerated time.
+
+Every DAQ package counts as 1 s of acquisition, but is only fed as soon as the previous one has
+been calculated, so long runs take a fraction of their simulated time. During the run the RSS,
+the number of objects per type and the size of known queues and buffers are sampled. The run fails
+if any of them grows by more than its budget after the warm up.
+
+A short run is done with
+    python -m pytest tests/soak.py
+and a full one, e.g. 72 h of acquisition, with
+    python -m tests.soak --hours 72
+"""
+import argparse
+import collections
+import gc
+import logging
+import os
+import resource
+import sys
+import tempfile
+import time
+from dataclasses import dataclass, field
+
+import numpy as np
+import pandas as pd
+
+import minipti
+from minipti.gui import model
+
+
+@dataclass(frozen=True)
+class Budget:
+    rss: float = 64  # MiB
+    objects: int = 20000  # Per type
+    probes: int = 100  # Entries of a queue or buffer without capacity
+    warm_up: float = 0.2  # Fraction of the run
+
+
+@dataclass
+class Sample:
+    time: float  # Simulated s
+    rss: float  # MiB
+    objects: collections.Counter = field(default_factory=collections.Counter)
+    probes: dict[str, int] = field(default_factory=dict)
+
+
+def resident_set_size() -> float:
+    try:
+        with open("/proc/self/statm") as statm:
+            return int(statm.read().split()[1]) * os.sysconf("SC_PAGE_SIZE") / (1 << 20)
+    except (FileNotFoundError, ValueError):  # No procfs, the peak is a conservative estimation
+        return resource.getrusage(resource.RUSAGE_SELF).ru_maxrss / (1 << 10)
+
+
+class Soak:
+    PARAMETER = minipti.algorithm.interferometry.CharacteristicParameter(
+        amplitudes=np.array([1., 0.9, 1.1]),
+        offsets=np.array([1.5, 1.4, 1.6]),
+        output_phases=np.array([0, 2 * np.pi / 3, 4 * np.pi / 3])
+    )
+
+    def __init__(self, hours: float, samples_per_package: int = 800, sample_interval: float = 3600,
+                 malformed_rate: float = 0.01, destination_folder: str | None = None):
+        """
+        Args:
+            samples_per_package (int): Samples of one package, fewer samples accelerate the run.
+            sample_interval (float): Simulated time in s between two samples of the resources.
+            malformed_rate (float): Probability of a DAQ frame being preceded by garbage.
+        """
+        self.packages = int(hours * 3600)
+        self.samples_per_package = samples_per_package
+        self.sample_interval = max(1, min(int(sample_interval), self.packages // 10))
+        self.destination_folder = tempfile.mkdtemp() if destination_folder is None else destination_folder
+        self.samples: list[Sample] = []
+        self.driver = model.serial_devices.DRIVER.motherboard
+        self.emulator = minipti.hardware.emulator.Motherboard(
+            minipti.hardware.emulator.Interferometer(Soak.PARAMETER, drift=0.05),
+            malformed_rate=malformed_rate
+        )
+        self.live = model.processing.LiveCalculation()
+
+    def _setup(self) -> None:
+        settings_path = f"{self.destination_folder}/settings.csv"
+        settings = pd.DataFrame(
+            [Soak.PARAMETER.amplitudes, Soak.PARAMETER.offsets, np.rad2deg(Soak.PARAMETER.output_phases),
+             self.emulator.response_phases],
+            index=["Amplitude [V]", "Offset [V]", "Output Phases [deg]", "Response Phases [rad]"],
+            columns=["Detector 1", "Detector 2", "Detector 3"]
+        )
+        settings.to_csv(settings_path, index_label="Setting")
+        model.signals.GENERAL_PURPORSE.destination_folder_changed.emit(self.destination_folder)
+        self.live.interferometer.settings_path = settings_path
+        self.live.pti.inversion.settings_path = settings_path
+        model.serial_devices.TOOLS.daq.number_of_samples = self.samples_per_package
+        self.driver.connected.set()
+        model.serial_devices.TOOLS.daq.running = True
+
+    def _probes(self) -> dict[str, int]:
+        return {
+            "Characterisation.tracking_phase": len(self.live.interferometer_characterization.tracking_phase),
+            "Characterisation.reservoir": len(self.live.interferometer_characterization.reservoir),
+            "Driver._package_buffer": self.driver.buffer_size,
+            "Driver.received_data": self.driver.received_data.qsize(),
+            "Driver.write_buffer": self.driver.write_buffer_size,
+            "DAQ.data": max(package.qsize() for package in self.driver.daq.data),
+            "DAQ.samples_buffer": self.driver.daq.samples_buffer_size
+        }
+
+    def _capacities(self) -> dict[str, int | None]:
+        """
+        Bounded buffers may grow up to their capacity, which is no leak.
+        """
+        return {
+            "Characterisation.tracking_phase": self.live.interferometer_characterization.tracking_phase.maxlen,
+            "Characterisation.reservoir": self.live.interferometer_characterization.reservoir.bins
+            * self.live.interferometer_characterization.reservoir.capacity,
+            # Up to one package is assembled from the frames at a time.
+            "DAQ.samples_buffer": self.samples_per_package + self.driver.daq.samples_per_frame
+        }
+
+    def _sample(self, package: int) -> None:
+        gc.collect()
+        objects = collections.Counter(type(o).__name__ for o in gc.get_objects())
+        self.samples.append(Sample(package, resident_set_size(), objects, self._probes()))
+        logging.info("Simulated %.1f h, RSS %.1f MiB", package / 3600, self.samples[-1].rss)
+
+    def _wait_for_calculation(self) -> None:
+        # The DAQ queues are not blocking, so they must not be filled faster than calculated.
+        while any(package.qsize() > 1 for package in self.driver.daq.data):
+            time.sleep(1e-4)
+
+    def run(self) -> list[Sample]:
+        self._setup()
+        self.live.process_daq_data()
+        start = time.perf_counter()
+        try:
+            for package in range(self.packages):
+                if package % self.sample_interval == 0:
+                    self._sample(package)
+                self.driver.received_data.put(self.emulator.frames(self.samples_per_package))
+                self.driver.encode_data()
+                self._wait_for_calculation()
+            self._sample(self.packages)
+        finally:
+            model.serial_devices.TOOLS.daq.running = False
+            self.driver.connected.clear()
+        logging.info("Simulated %.1f h in %.1f s", self.packages / 3600, time.perf_counter() - start)
+        return self.samples
+
+    def violations(self, budget: Budget) -> list[str]:
+        baseline = next(sample for sample in self.samples if sample.time >= budget.warm_up * self.packages)
+        last = self.samples[-1]
+        violations = []
+        if last.rss - baseline.rss > budget.rss:
+            violations.append(f"RSS grew by {last.rss - baseline.rss:.1f} MiB")
+        for name, growth in (last.objects - baseline.objects).items():
+            if growth > budget.objects:
+                violations.append(f"{growth} more objects of {name}")
+        capacities = self._capacities()
+        for name, size in last.probes.items():
+            if capacities.get(name) is not None:
+                if size > capacities[name]:
+                    violations.append(f"{name} exceeds its capacity of {capacities[name]} entries")
+            elif size - baseline.probes[name] > budget.probes:
+                violations.append(f"{name} grew by {size - baseline.probes[name]} entries")
+        return violations
+
+
+def test_soak() -> None:
+    soak = Soak(hours=float(os.getenv("SOAK_HOURS", 0.05)))
+    soak.run()
+    assert not soak.violations(Budget())
+
+
+def main() -> int:
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--hours", type=float, default=72, help="Simulated acquisition time")
+    parser.add_argument("--samples-per-package", type=int, default=800)
+    parser.add_argument("--malformed-rate", type=float, default=0.01)
+    parser.add_argument("--rss-budget", type=float, default=Budget.rss, help="MiB")
+    parser.add_argument("--object-budget", type=int, default=Budget.objects)
+    parser.add_argument("--probe-budget", type=int, default=Budget.probes)
+    parser.add_argument("--destination-folder")
+    arguments = parser.parse_args()
+    logging.basicConfig(level=logging.INFO, format="%(levelname)s %(asctime)s: %(message)s")
+    soak = Soak(arguments.hours, arguments.samples_per_package, malformed_rate=arguments.malformed_rate,
+                destination_folder=arguments.destination_folder)
+    soak.run()
+    violations = soak.violations(Budget(arguments.rss_budget, arguments.object_budget, arguments.probe_budget))
+    for violation in violations:
+        logging.error(violation)
+    return 1 if violations else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
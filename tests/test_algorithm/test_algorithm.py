@@ -1,9 +1,13 @@
 """
 Unit tests for Characterisation algorithm of an interferometer.
 """
+import dataclasses
+import itertools
 import os
+import tracemalloc
 import pytest
 
+import h5py
 import numpy as np
 import pandas as pd
 
@@ -128,3 +132,408 @@ class TestCharacterisation:
         np.testing.assert_allclose(self.interferometer.output_phases, output_phases, 1e-3)
         np.testing.assert_allclose(self.interferometer.amplitudes, ideal_amplitudes, 1e-3)
         np.testing.assert_allclose(self.interferometer.offsets, ideal_offsets, 1e-3)
+
+    @pytest.mark.parametrize("refine", [False, True])
+    def test_ellipse_fit(self, setup, monkeypatch, refine) -> None:
+        configuration = dataclasses.replace(minipti.algorithm.interferometry.Characterization.CONFIGURATION,
+                                            mode="ellipse", refine=refine)
+        monkeypatch.setattr(minipti.algorithm.interferometry.Characterization, "CONFIGURATION", configuration)
+        generator = np.random.default_rng(0)
+        phases = generator.uniform(0, 2 * np.pi, 1000)
+        output_phases = np.array([0, 0.4, 0.7]) * 2 * np.pi
+        amplitudes = np.array([1, 0.8, 1.2])
+        offsets = np.array([1.5, 1.4, 1.6])
+        self.interferometer.intensities = offsets + amplitudes * np.cos(phases[:, np.newaxis] - output_phases) \
+            + generator.normal(scale=1e-3, size=(1000, 3))
+        self.characterization._characterise()
+        if self.interferometer.output_phases[1] > np.pi:  # Mirrored solution
+            self.interferometer.output_phases[1:] = 2 * np.pi - np.array(self.interferometer.output_phases[1:])
+        np.testing.assert_allclose(self.interferometer.output_phases, output_phases, atol=5e-3)
+        np.testing.assert_allclose(self.interferometer.amplitudes, amplitudes, rtol=5e-3)
+        np.testing.assert_allclose(self.interferometer.offsets, offsets, rtol=5e-3)
+        assert len(self.interferometer.phase) == 1000
+
+    @pytest.mark.parametrize("process", [False, True])
+    def test_live_characterisation(self, setup, monkeypatch, tmp_path, process) -> None:
+        configuration = dataclasses.replace(minipti.algorithm.interferometry.Characterization.CONFIGURATION,
+                                            mode="ellipse", refine=False, process=process)
+        monkeypatch.setattr(minipti.algorithm.interferometry.Characterization, "CONFIGURATION", configuration)
+        output_phases = np.array([0, 0.4, 0.7]) * 2 * np.pi
+        amplitudes = np.array([1, 0.8, 1.2])
+        offsets = np.array([1.5, 1.4, 1.6])
+        self.characterization.destination_folder = tmp_path
+        generator = np.random.default_rng(0)
+        for phase in generator.uniform(0, 2 * np.pi, 2000):
+            self.characterization.add_phase(phase, offsets + amplitudes * np.cos(phase - output_phases)
+                                            + generator.normal(scale=1e-3, size=3))
+        published = self.interferometer.characteristic_parameter
+        assert self.characterization.take_samples()
+        assert len(self.characterization.reservoir) == 0  # Handed over, the calculation collects anew
+        self.interferometer.phase = 1.
+        try:
+            assert self.characterization.characterise(live=True)
+        finally:
+            self.characterization.close()
+        # The characterisation worked on its own copy and replaced the parameters as a whole.
+        assert self.interferometer.phase == 1. and self.characterization.interferometer is self.interferometer
+        assert published.amplitudes is not self.interferometer.amplitudes
+        np.testing.assert_allclose(published.amplitudes, 0)
+        if self.interferometer.output_phases[1] > np.pi:  # Mirrored solution
+            output_phases[1:] = 2 * np.pi - output_phases[1:]
+        np.testing.assert_allclose(self.interferometer.output_phases, output_phases, atol=5e-3)
+        np.testing.assert_allclose(self.interferometer.amplitudes, amplitudes, rtol=5e-3)
+        assert not self.characterization.event.is_set()
+
+    def test_reservoir_bounded(self) -> None:
+        reservoir = minipti.algorithm.interferometry.PhaseReservoir(bins=10, capacity=5, dimension=3, seed=0)
+        for i in range(10000):
+            reservoir.add(0.1, np.full(3, i))  # Long dwell time in one bin
+        reservoir.add(np.pi, np.full(3, -1))
+        assert len(reservoir) == 6 and reservoir.occupied_bins == 2
+        assert reservoir.samples.shape == (6, 3)
+        assert np.any(reservoir.samples[:5] >= 5)  # Later samples replaced earlier ones
+        reservoir.clear()
+        assert len(reservoir) == 0
+
+    def test_reservoir_uniform(self) -> None:
+        reservoir = minipti.algorithm.interferometry.PhaseReservoir(bins=1, capacity=1000, dimension=1, seed=0)
+        for i in range(100000):
+            reservoir.add(0, np.array([i]))
+        # Every sample has the same probability to be kept, so the kept ones are uniformly distributed.
+        assert abs(np.mean(reservoir.samples) - 50000) < 3000
+
+
+class TestBackend:
+    def test_equivalence(self) -> None:
+        for kernel, backends in minipti.algorithm.backend.kernels().items():
+            for backend in backends:
+                assert minipti.algorithm.backend.is_equivalent(kernel, backend), f"{kernel}: {backend}"
+
+    @pytest.fixture
+    def lock_in(self):
+        selected = minipti.algorithm.backend.selected("lock_in")
+        yield
+        minipti.algorithm.backend.select("lock_in", selected)
+
+    def test_unavailable_backend(self, lock_in) -> None:
+        minipti.algorithm.backend.select("lock_in", "unavailable")
+        assert minipti.algorithm.backend.selected("lock_in") == minipti.algorithm.backend.REFERENCE
+
+    def test_default(self) -> None:
+        # The reference backend is shipped, the others are opt-in per kernel.
+        assert minipti.algorithm.backend.selected("lock_in") == minipti.algorithm.backend.REFERENCE
+
+    def test_auto(self) -> None:
+        minipti.algorithm.backend.select("rolling", minipti.algorithm.backend.AUTO)
+        assert minipti.algorithm.backend.selected("rolling") in minipti.algorithm.backend.kernels()["rolling"]
+        minipti.algorithm.backend.select("rolling", minipti.algorithm.backend.REFERENCE)
+
+    def test_shadow(self, tmp_path) -> None:
+        backend = minipti.algorithm.backend
+        shadow = backend.Shadow()
+        shadow.destination_folder = str(tmp_path)
+        kernel = backend._KERNELS["lock_in"]
+        arguments = kernel.sample()
+        backend.shadow("lock_in", "numpy")
+        try:
+            expected = kernel.implementations[backend.selected("lock_in")](*arguments)
+            for _ in range(3):
+                np.testing.assert_array_equal(shadow.call("lock_in", *arguments)[0], expected[0])
+            kernel.implementations["offset"] = lambda *values: tuple(output + 1 for output in
+                                                                     kernel.implementations["numpy"](*values))
+            backend.shadow("lock_in", "offset")
+            # The production result is kept, even if the shadow differs.
+            np.testing.assert_array_equal(shadow.call("lock_in", *arguments)[0], expected[0])
+            shadow.join()
+        finally:
+            backend.shadow("lock_in", None)
+            del kernel.implementations["offset"]
+        minipti.algorithm._utilities.CSV_ROWS.flush()
+        rows = pd.read_csv(shadow.file_path)
+        assert list(rows["Shadow"]) == ["numpy"] * 3 + ["offset"]
+        assert np.all(rows["Mismatches"][:3] == 0)
+        assert rows["Mismatches"][3] == rows["Elements"][3] == 6
+        np.testing.assert_allclose(rows["Max Absolute Difference"][3], 1)
+        assert np.all(rows["Shadow CPU Time [ms]"] >= 0)
+
+
+class TestLiveFile:
+    def test_follow(self, tmp_path) -> None:
+        live_file = minipti.algorithm.swmr.LiveFile(f"{tmp_path}/Live.hdf5")
+        live_file.append("PTI Inversion", **{"PTI Signal": 1.})
+        follow = minipti.algorithm.swmr.follow(live_file.file_path, "PTI Inversion", poll_interval=0.01, timeout=1)
+        rows = next(follow)
+        np.testing.assert_array_equal(rows["PTI Signal"], [1.])
+        live_file.append("PTI Inversion", **{"PTI Signal": 2.})
+        live_file.append("PTI Inversion", **{"PTI Signal": 3.})
+        rows = next(follow)
+        np.testing.assert_array_equal(rows["PTI Signal"], [2., 3.])
+        assert len(rows["Time"]) == 2
+        follow.close()
+        live_file.close()
+
+    def test_raw_data(self, tmp_path) -> None:
+        live_file = minipti.algorithm.swmr.LiveFile(f"{tmp_path}/Live.hdf5")
+        generator = np.random.default_rng(0)
+        packages = []
+        for samples in (100, 200):
+            ac = generator.integers(-100, 100, size=(3, samples), dtype=np.int16)
+            dc = generator.integers(0, 4095, size=(3, samples), dtype=np.uint16)
+            live_file.append_raw(np.zeros(samples), ac, dc)
+            packages.append((ac, dc))
+        decimation = minipti.algorithm.pti.Decimation()
+        decimation.file_path = live_file.file_path
+        for (ac, dc), progress in zip(packages, decimation.get_raw_data()):
+            np.testing.assert_array_equal(decimation.raw_data.ac, ac)
+            np.testing.assert_array_equal(decimation.raw_data.dc, dc)
+        assert progress == 1
+        live_file.close()
+
+    @pytest.mark.parametrize("live, window, hop",
+                             [(True, 300, 100), (True, 100, 300), (False, 400, 200), (False, 100, 400)])
+    def test_resliced_raw_data(self, tmp_path, live, window, hop) -> None:
+        generator = np.random.default_rng(0)
+        ac = generator.integers(-100, 100, size=(3, 900), dtype=np.int16)
+        dc = generator.integers(0, 4095, size=(3, 900), dtype=np.uint16)
+        file_path = f"{tmp_path}/Raw.hdf5"
+        if live:
+            live_file = minipti.algorithm.swmr.LiveFile(file_path)
+            for start, end in ((0, 200), (200, 500), (500, 900)):
+                live_file.append_raw(np.zeros(end - start), ac[:, start:end], dc[:, start:end])
+            live_file.close()
+        else:
+            with h5py.File(file_path, "w") as h5f:
+                for i, (start, end) in enumerate(((0, 200), (200, 500), (500, 900))):
+                    h5f[f"{i}/AC"] = ac[:, start:end]
+                    h5f[f"{i}/DC"] = dc[:, start:end]
+        decimation = minipti.algorithm.pti.Decimation()
+        decimation.file_path = file_path
+        decimation.window = window / decimation.sample_rate
+        decimation.hop = hop / decimation.sample_rate
+        starts = range(0, 900 - window + 1, hop)
+        for start, progress in itertools.zip_longest(starts, decimation.get_raw_data()):
+            np.testing.assert_array_equal(decimation.raw_data.ac, ac[:, start:start + window])
+            np.testing.assert_array_equal(decimation.raw_data.dc, dc[:, start:start + window])
+            assert decimation.average_period == window
+            assert progress == (start + window) / 900
+
+    @pytest.mark.parametrize("window, hop", [(250, 100), (300, 150)])
+    def test_resliced_no_reference_period(self, tmp_path, window, hop) -> None:
+        file_path = f"{tmp_path}/Raw.hdf5"
+        with h5py.File(file_path, "w") as h5f:
+            h5f["0/AC"] = np.zeros((3, 900), dtype=np.int16)
+            h5f["0/DC"] = np.zeros((3, 900), dtype=np.uint16)
+        decimation = minipti.algorithm.pti.Decimation()
+        decimation.file_path = file_path
+        decimation.window = window / decimation.sample_rate
+        decimation.hop = hop / decimation.sample_rate
+        with pytest.raises(ValueError):
+            next(decimation.get_raw_data())
+
+    @pytest.mark.parametrize("window", [0, 300])
+    def test_legacy_package_order(self, tmp_path, window) -> None:
+        generator = np.random.default_rng(0)
+        ac = generator.integers(-100, 100, size=(3, 1200), dtype=np.int16)
+        dc = generator.integers(0, 4095, size=(3, 1200), dtype=np.uint16)
+        file_path = f"{tmp_path}/Raw.hdf5"
+        with h5py.File(file_path, "w") as h5f:
+            for i, start in enumerate(range(0, 1200, 100)):  # Named "0" - "11"
+                h5f[f"{i}/AC"] = ac[:, start:start + 100]
+                h5f[f"{i}/DC"] = dc[:, start:start + 100]
+        decimation = minipti.algorithm.pti.Decimation()
+        decimation.file_path = file_path
+        decimation.window = window / decimation.sample_rate
+        length = window if window else 100
+        for start, _ in itertools.zip_longest(range(0, 1200, length), decimation.get_raw_data()):
+            np.testing.assert_array_equal(decimation.raw_data.ac, ac[:, start:start + length])
+            np.testing.assert_array_equal(decimation.raw_data.dc, dc[:, start:start + length])
+
+
+class TestWorkingPoint:
+    PARAMETER = minipti.algorithm.interferometry.CharacteristicParameter(
+        amplitudes=np.array([1., 0.8, 1.2]),
+        offsets=np.array([1.5, 1.4, 1.6]),
+        output_phases=np.array([0, 2 * np.pi / 3, 4 * np.pi / 3])
+    )
+
+    def test_phase_estimation(self) -> None:
+        phases = np.linspace(0, 2 * np.pi, 100, endpoint=False)
+        intensities = TestWorkingPoint.PARAMETER.offsets + TestWorkingPoint.PARAMETER.amplitudes * np.cos(
+            phases[:, np.newaxis] - TestWorkingPoint.PARAMETER.output_phases)
+        estimator = minipti.algorithm.control.PhaseEstimator(TestWorkingPoint.PARAMETER)
+        difference = np.angle(np.exp(1j * (estimator(intensities) - phases)))
+        np.testing.assert_allclose(difference, 0, atol=1e-9)
+
+    def test_closed_loop(self) -> None:
+        settings = minipti.algorithm.control.WorkingPointSettings(use=True, proportional_gain=10, integral_gain=5,
+                                                                   max_rate=20)
+        controller = minipti.algorithm.control.WorkingPointController(TestWorkingPoint.PARAMETER, 128, settings)
+        plant = minipti.hardware.emulator.Interferometer(TestWorkingPoint.PARAMETER, phase=0.3, actuator=128)
+        result = minipti.hardware.emulator.simulate_working_point(controller, plant, duration=300, period=0.1)
+        optimum = minipti.algorithm.control.total_sensitivity(controller.target_phase, TestWorkingPoint.PARAMETER)
+        assert result["Total Sensitivity"].loc[60:].min() > 0.99 * optimum
+        assert np.all(np.abs(np.diff(result["Command"])) <= settings.max_rate * 0.1 + 1e-9)
+
+    def test_anti_windup(self) -> None:
+        limits = {"probe_laser": minipti.algorithm.control.OutputLimits(0, 130)}
+        settings = minipti.algorithm.control.WorkingPointSettings(use=True, limits=limits, max_rate=1000)
+        controller = minipti.algorithm.control.WorkingPointController(TestWorkingPoint.PARAMETER, 128, settings)
+        for _ in range(100):
+            output = controller.update(controller.target_phase - 0.5, period=1)
+        assert output == 130 and controller.saturated
+        # Without wind up, the output leaves the limit as soon as the error changes its sign.
+        assert controller.update(controller.target_phase + 0.5, period=1) < 130
+
+    def test_actuator_limits(self) -> None:
+        settings = minipti.algorithm.control.WorkingPointSettings(use=True, actuator="tec", max_rate=1000)
+        controller = minipti.algorithm.control.WorkingPointController(TestWorkingPoint.PARAMETER, 23, settings)
+        for _ in range(100):
+            output = controller.update(controller.target_phase - 0.5, period=1)
+        # The limits of the probe laser current bits are no temperatures.
+        assert output == settings.output_limits.maximum == 35
+        assert minipti.algorithm.control.CONFIGURATION.limits["tec"].maximum < 100
+
+
+class TestResponsePhaseTracker:
+    SETTINGS = minipti.algorithm.pti.ResponsePhaseTrackingSettings(use=True, time_constant=100, min_samples=20)
+
+    def test_pi_ambiguity(self) -> None:
+        tracker = minipti.algorithm.pti.ResponsePhaseTracker(settings=TestResponsePhaseTracker.SETTINGS)
+        generator = np.random.default_rng(0)
+        response_phases = np.array([1.05, 0.2, 3.])
+        for i in range(1000):
+            # The lock in phase flips by pi with the slope of the interferometer.
+            phase = response_phases + np.pi * (i // 50 % 2) + generator.normal(scale=1e-3, size=3)
+            tracker.update(np.full(3, 1e-3), phase)
+        difference = np.angle(np.exp(2j * (tracker.published.phases - response_phases))) / 2
+        np.testing.assert_allclose(difference, 0, atol=5e-3)
+        assert tracker.published.version > 0
+
+    def test_gate(self) -> None:
+        tracker = minipti.algorithm.pti.ResponsePhaseTracker(settings=TestResponsePhaseTracker.SETTINGS)
+        generator = np.random.default_rng(0)
+        for _ in range(1000):
+            # Weak signal in every channel and a random phase in the first one.
+            tracker.update(np.array([1e-3, 1e-5, 1e-5]), generator.uniform(0, 2 * np.pi, 3))
+        np.testing.assert_array_equal(tracker.gated_samples, 0)
+        assert tracker.published.version == 0
+
+    def test_inversion(self) -> None:
+        inversion = minipti.algorithm.pti.Inversion(response_phases=np.zeros(3),
+                                                    decimation=minipti.algorithm.pti.Decimation())
+        loaded = inversion.response_phases.copy()
+        inversion.response_phase_tracker = minipti.algorithm.pti.ResponsePhaseTracker(
+            settings=TestResponsePhaseTracker.SETTINGS)
+        inversion.decimation.lock_in = minipti.algorithm.pti.LockIn(np.array([1e-3, 1e-3, 1e-5]),
+                                                                     np.array([0.5, 0.6, 0.7]))
+        changes = [inversion.track_response_phase() for _ in range(100)]
+        assert any(changes)
+        np.testing.assert_allclose(inversion.response_phases, [0.5, 0.6, loaded[2]])
+        assert inversion.response_phase_version == inversion.response_phase_tracker.published.version
+
+
+class TestCommonMode:
+    def test_default(self) -> None:
+        # The static reduction is applied by default, the adaptive cancellation is opt-in.
+        assert minipti.algorithm.pti.CommonModeSettings().method == "static"
+        decimation = minipti.algorithm.pti.Decimation()
+        assert decimation.common_mode.settings.method == "static"
+        assert decimation.use_common_mode_noise_reduction
+
+    def test_cancellation(self) -> None:
+        canceller = minipti.algorithm.pti.CommonModeCanceller(
+            settings=minipti.algorithm.pti.CommonModeSettings(method="adaptive"))
+        generator = np.random.default_rng(0)
+        samples = np.arange(8000)
+        pti_signal = 1e-4 * np.cos(2 * np.pi / 100 * samples - np.array([[0.], [2.], [4.]]))
+        for _ in range(8):
+            # Intensity noise which varies within the package, seen by the DC and AC channels.
+            intensity_noise = np.convolve(generator.normal(scale=0.1, size=8000), np.ones(4) / 4, mode="same")
+            dc = 1 + np.array([[0.5], [0.4], [0.6]]) * intensity_noise
+            ac = pti_signal + np.array([[0.02], [0.03], [0.01]]) * intensity_noise
+            cleaned = canceller(ac, dc)
+        assert np.all(canceller.reduction < 0.05)
+        assert np.std(cleaned - pti_signal) < 0.2 * np.std(ac - pti_signal)
+
+    @pytest.mark.parametrize("method", ["static", "adaptive"])
+    def test_flag(self, tmp_path, method) -> None:
+        decimation = minipti.algorithm.pti.Decimation()
+        decimation.common_mode = minipti.algorithm.pti.CommonModeCanceller(
+            settings=minipti.algorithm.pti.CommonModeSettings(method=method))
+        decimation.destination_folder = str(tmp_path)
+        generator = np.random.default_rng(0)
+        decimation.raw_data = minipti.algorithm.pti.RawData(np.zeros(8000), 1 + generator.normal(size=(3, 8000)),
+                                                            generator.normal(size=(3, 8000)))
+        ac = decimation.raw_data.ac.copy()
+        decimation.use_common_mode_noise_reduction = False
+        decimation._calculate_decimation()
+        np.testing.assert_array_equal(decimation.raw_data.ac, ac)
+        decimation.use_common_mode_noise_reduction = True
+        decimation._calculate_decimation()
+        assert not np.array_equal(decimation.raw_data.ac, ac)
+
+
+class TestAveragePeriod:
+    def test_package_boundary(self, tmp_path) -> None:
+        decimation = minipti.algorithm.pti.Decimation()
+        decimation.destination_folder = str(tmp_path)
+        generator = np.random.default_rng(0)
+        for samples in (8000, 4000, 8000):
+            decimation.raw_data.ref = np.zeros(samples, dtype=np.int64)
+            decimation.raw_data.dc = generator.integers(100, 4000, size=(3, samples))
+            decimation.raw_data.ac = generator.integers(-3000, 3000, size=(3, samples))
+            decimation.run(live=True)
+            assert decimation.average_period == samples and decimation.in_phase.shape == (samples,)
+        # The look-up tables are calculated once per period.
+        assert decimation.in_phase is minipti.algorithm.pti.Decimation._look_up_table(8000, decimation.ref_period)[0]
+        # The change of the period is recorded in the decimation file as well, not only in the opt-in live file.
+        minipti.algorithm._utilities.CSV_ROWS.flush()
+        data = pd.read_csv(decimation._file_path("Decimation.csv"), skiprows=[1])
+        np.testing.assert_array_equal(data["Average Period"], [8000 / decimation.sample_rate,
+                                                               4000 / decimation.sample_rate,
+                                                               8000 / decimation.sample_rate])
+
+
+class TestAllocations:
+    """
+    The steady state of the live calculation must not allocate arrays of the size of a package.
+    """
+    PEAK_BUDGET = 32 << 10  # Bytes per cycle, a package of raw data has 192 kiB
+    CYCLES = 10
+
+    @pytest.fixture
+    def setup(self, tmp_path):
+        # The reference lock in has temporaries of the size of a package.
+        selected = minipti.algorithm.backend.selected("lock_in")
+        minipti.algorithm.backend.select("lock_in", "native")
+        self.decimation = minipti.algorithm.pti.Decimation()
+        self.decimation.destination_folder = str(tmp_path)
+        self.interferometer = minipti.algorithm.interferometry.Interferometer()
+        self.interferometer.destination_folder = str(tmp_path)
+        self.interferometer.load_settings()
+        self.inversion = minipti.algorithm.pti.Inversion(decimation=self.decimation,
+                                                         interferometer=self.interferometer)
+        self.inversion.destination_folder = str(tmp_path)
+        generator = np.random.default_rng(0)
+        self.package = (np.zeros(8000, dtype=np.int64), generator.integers(100, 4000, size=(3, 8000)),
+                        generator.integers(-3000, 3000, size=(3, 8000)))
+        yield
+        tracemalloc.stop()
+        minipti.algorithm.backend.select("lock_in", selected)
+
+    def _cycle(self) -> None:
+        self.decimation.raw_data.ref, self.decimation.raw_data.dc, self.decimation.raw_data.ac = self.package
+        self.decimation.run(live=True)
+        self.interferometer.intensities = self.decimation.dc_signals
+        self.interferometer.run(live=True)
+        self.inversion.run(live=True)
+
+    def test_live_cycle(self, setup) -> None:
+        for _ in range(3):  # Allocates the workspaces and writes the headers
+            self._cycle()
+        tracemalloc.start()
+        for _ in range(TestAllocations.CYCLES):
+            before, _ = tracemalloc.get_traced_memory()
+            tracemalloc.reset_peak()
+            self._cycle()
+            assert tracemalloc.get_traced_memory()[1] - before < TestAllocations.PEAK_BUDGET
@@ -1,9 +1,19 @@
+import functools
+import itertools
+import multiprocessing
 import os
+import queue
 import sys
+import threading
+import time
+import types
 
+import h5py
 import pandas as pd
+import pytest
 import numpy as np
 import copy
+import json
 
 sys.path.append(".")
 
@@ -38,3 +48,352 @@ class TestSettingsTable:
         )
         pd.testing.assert_frame_equal(old_settings.drop(["Response Phases [rad]"]),
                                       new_settings.drop(["Response Phases [rad]"]))
+
+
+def _process_task(steps: int):
+    for i in range(1, steps + 1):
+        yield i / steps
+
+
+def _endless_process_task():
+    while True:
+        time.sleep(0.01)
+        yield 0.5
+
+
+class TestJobs:
+    def test_progress(self) -> None:
+        executor = minipti.gui.model.jobs.Executor(max_workers=1)
+        finished = []
+
+        def task():
+            for i in range(1, 5):
+                yield i / 4
+
+        job = executor.submit(minipti.gui.model.jobs.Job("Test", task, on_finished=lambda: finished.append(True)))
+        job.wait(timeout=5)
+        assert job.done and job.progress == 1 and job.eta == 0
+        assert finished
+
+    def test_cancel(self) -> None:
+        executor = minipti.gui.model.jobs.Executor(max_workers=1)
+        started = threading.Event()
+        release = threading.Event()
+
+        def task():
+            started.set()
+            release.wait(timeout=5)
+            for i in range(1, 101):
+                yield i / 100
+
+        running = executor.submit(minipti.gui.model.jobs.Job("Running", task))
+        queued = executor.submit(minipti.gui.model.jobs.Job("Queued", task))
+        started.wait(timeout=5)
+        executor.cancel_all()
+        release.set()
+        running.wait(timeout=5)
+        queued.wait(timeout=5)
+        assert running.cancelled and running.progress < 1
+        assert queued.progress == 0
+
+    def test_concurrent_calculations(self, tmp_path) -> None:
+        calculation = minipti.gui.model.processing.OfflineCalculation()
+        calculation.jobs = minipti.gui.model.jobs.Executor(max_workers=2)
+        calculation._update_destination_folder(str(tmp_path))
+        decimation_path = f"{tmp_path}/Decimation.csv"
+        with open(f"{TestSettingsTable.BASE_DIR}/Decimation_Comercial.csv") as sample, \
+                open(decimation_path, "w") as data:
+            data.writelines(itertools.islice(sample, 1000))
+        submitted = [calculation.submit_interferometry(decimation_path), calculation.submit_inversion(decimation_path)]
+        for job in submitted:
+            job.wait(timeout=60)
+            assert job.done and job._future.exception() is None
+        # Every job has its own algorithm objects.
+        assert np.all(calculation.interferometer.phase == 0)
+        assert os.path.exists(f"{tmp_path}/Offline_Interferometer.csv")
+        assert os.path.exists(f"{tmp_path}/Offline_PTI_Inversion.csv")
+
+    @pytest.mark.parametrize("use_processes", [False, True])
+    def test_decimation_path_prefix(self, tmp_path, monkeypatch, use_processes) -> None:
+        raw_path = f"{tmp_path}/Raw.hdf5"
+        generator = np.random.default_rng(0)
+        with h5py.File(raw_path, "w") as h5f:
+            for i in range(2):
+                h5f[f"{i}/AC"] = generator.integers(-3000, 3000, size=(3, 8000), dtype=np.int16)
+                h5f[f"{i}/DC"] = generator.integers(100, 4000, size=(3, 8000), dtype=np.uint16)
+        calculation = minipti.gui.model.processing.OfflineCalculation()
+        calculation.jobs = minipti.gui.model.jobs.Executor(max_workers=1, use_processes=use_processes)
+        calculation._update_destination_folder(str(tmp_path))
+        monkeypatch.setattr(minipti, "path_prefix", "20240101_120000")
+        finished = []
+        monkeypatch.setattr(minipti.gui.model.processing, "process_dc_data", finished.append)
+        job = calculation.submit_decimation(raw_path)
+        # A run started after the submission does not change the files of the job.
+        monkeypatch.setattr(minipti, "path_prefix", "20240101_130000")
+        job.wait(timeout=60)
+        assert job.done and job._future.exception() is None
+        assert finished == [f"{tmp_path}/20240101_120000_Decimation.csv"]
+        assert len(pd.read_csv(finished[0], skiprows=[1])) == 2
+
+    def test_process_progress(self) -> None:
+        executor = minipti.gui.model.jobs.Executor(max_workers=1, use_processes=True)
+        progress = []
+        executor._update_progress = lambda: progress.append(job.progress)
+        job = minipti.gui.model.jobs.Job("Process", task=lambda: None,
+                                         process_task=functools.partial(_process_task, 4))
+        executor.submit(job)
+        job.wait(timeout=30)
+        assert job.done and job.progress == 1 and job.eta == 0
+        assert {0.25, 0.5, 0.75} <= set(progress)
+
+    def test_process_cancel(self) -> None:
+        executor = minipti.gui.model.jobs.Executor(max_workers=1, use_processes=True)
+        job = executor.submit(minipti.gui.model.jobs.Job("Endless", task=lambda: None,
+                                                         process_task=_endless_process_task))
+        deadline = time.monotonic() + 30
+        while job.progress == 0 and time.monotonic() < deadline:
+            time.sleep(0.01)
+        assert job.progress == 0.5
+        job.cancel()
+        job.wait(timeout=5)
+        assert job.done and job.progress == 0.5
+        assert not [child for child in multiprocessing.active_children() if child.name == "Endless"]
+
+
+class TestWorkingPointActuator:
+    def test_tec_setpoint_on_change(self, monkeypatch) -> None:
+        monkeypatch.setattr(minipti.algorithm.control, "CONFIGURATION",
+                            minipti.algorithm.control.WorkingPointSettings(actuator="tec"))
+        tec = minipti.gui.model.serial_devices.TOOLS.tec[minipti.gui.model.serial_devices.Tec.PROBE_LASER]
+        written = []
+        monkeypatch.setattr(tec.tec, "set_setpoint_temperature_value",
+                            lambda: written.append(tec.setpoint_temperature))
+        monkeypatch.setattr(tec.tec.configuration.system_parameter, "setpoint_temperature", 23.)
+        calculation = minipti.gui.model.processing.LiveCalculation()
+        for value in (23., 23.001, 23.2, 23.2, 23.199):
+            calculation._working_point_actuator = value
+        assert written == [23.2]
+
+
+class TestBuffer:
+    @staticmethod
+    def _interferometer(value: float) -> types.SimpleNamespace:
+        return types.SimpleNamespace(intensities=np.full(3, value), phase=value, sensitivity=np.full(3, value))
+
+    def test_snapshot(self) -> None:
+        interferometer_buffer = minipti.gui.model.buffer.Interferometer()
+        size = interferometer_buffer.QUEUE_SIZE
+        for i in range(3 * size + 7):
+            interferometer_buffer.append(TestBuffer._interferometer(i))
+        snapshot = interferometer_buffer.snapshot()
+        np.testing.assert_array_equal(snapshot.time, np.arange(2 * size + 7, 3 * size + 7))
+        np.testing.assert_array_equal(snapshot.dc_values, np.tile(snapshot.time, (3, 1)))
+        assert not snapshot.sensitivity.flags.writeable
+        interferometer_buffer.clear()
+        assert interferometer_buffer.is_empty and len(interferometer_buffer.snapshot().time) == 0
+        np.testing.assert_array_equal(snapshot.interferometric_phase, snapshot.time)
+
+    def test_concurrent_writer(self) -> None:
+        interferometer_buffer = minipti.gui.model.buffer.Interferometer()
+        snapshots = queue.Queue()
+
+        def write():
+            for i in range(5 * interferometer_buffer.QUEUE_SIZE):
+                interferometer_buffer.append(TestBuffer._interferometer(i))
+                snapshots.put(interferometer_buffer.snapshot())
+            snapshots.put(None)
+
+        writer = threading.Thread(target=write)
+        writer.start()
+        consistent = 0
+        while (snapshot := snapshots.get(timeout=5)) is not None:
+            owned = snapshot.owned()
+            if snapshot.valid:
+                np.testing.assert_array_equal(owned.dc_values, np.tile(owned.time, (3, 1)))
+                np.testing.assert_array_equal(np.diff(owned.time), 1)
+                consistent += 1
+        writer.join()
+        assert consistent > 0
+
+    def test_owned(self) -> None:
+        interferometer_buffer = minipti.gui.model.buffer.Interferometer()
+        for i in range(10):
+            interferometer_buffer.append(TestBuffer._interferometer(i))
+        owned = interferometer_buffer.snapshot().owned()
+        for i in range(3 * interferometer_buffer.QUEUE_SIZE):
+            interferometer_buffer.append(TestBuffer._interferometer(-1))
+        assert owned.valid
+        np.testing.assert_array_equal(owned.time, np.arange(10))
+        np.testing.assert_array_equal(owned.dc_values, np.tile(np.arange(10), (3, 1)))
+
+    def test_request_clear(self) -> None:
+        interferometer_buffer = minipti.gui.model.buffer.Interferometer()
+        for i in range(10):
+            interferometer_buffer.append(TestBuffer._interferometer(i))
+        interferometer_buffer.request_clear()
+        assert len(interferometer_buffer.snapshot().time) == 10  # Cleared by the writer
+        interferometer_buffer.append(TestBuffer._interferometer(0))
+        np.testing.assert_array_equal(interferometer_buffer.snapshot().time, [0])
+        assert len(interferometer_buffer.history) == 1
+
+
+class TestHistory:
+    def test_window(self) -> None:
+        history = minipti.gui.model.history.History(columns=2, chunk_size=256, resident_chunks=4)
+        rows = 20000
+        values = np.random.default_rng(0).normal(size=(2, rows)).astype(np.float32)
+        for i in range(rows):
+            history.append(i, values[:, i])
+        assert len(history) == rows and history.spilled_chunks == rows // 256 - 4
+        window = history.window(1000, 1499, points=500)
+        np.testing.assert_array_equal(window[0], np.arange(1000, 1500))
+        np.testing.assert_array_equal(window[1:], values[:, 1000:1500])
+        for start, end in ((0, rows), (100, 10000), (5000, 5000 + 100 * 64)):
+            window = history.window(start, end, points=200)
+            assert window.shape[1] <= 200
+            np.testing.assert_array_less(window[0, :-1], window[0, 1:] + 1)
+            # The envelope covers every row of the range.
+            assert np.all(window[1:].min(axis=1) <= values[:, start:end + 1].min(axis=1))
+            assert np.all(window[1:].max(axis=1) >= values[:, start:end + 1].max(axis=1))
+        history.close()
+
+    def test_nan_rows(self) -> None:
+        # The mean and median of the PTI buffer are NaN for average periods other than 1 s.
+        history = minipti.gui.model.history.History(columns=2, chunk_size=256, resident_chunks=4)
+        rows = 4096
+        values = np.random.default_rng(0).normal(size=(2, rows)).astype(np.float32)
+        values[1, ::2] = np.nan
+        values[1, 1024:2048] = np.nan
+        for i in range(rows):
+            history.append(i, values[:, i])
+        for points in (100, 20):  # Envelope of blocks and of chunks
+            window = history.window(0, rows, points=points)
+            np.testing.assert_array_equal(window[1].min(), values[0].min())
+            np.testing.assert_array_equal(window[1].max(), values[0].max())
+            np.testing.assert_array_equal(np.nanmin(window[2]), np.nanmin(values[1]))
+            np.testing.assert_array_equal(np.nanmax(window[2]), np.nanmax(values[1]))
+            assert not np.isinf(window).any()
+        gap = history.window(1024, 2047, points=20)
+        assert np.isnan(gap[2]).all() and not np.isnan(gap[1]).any()
+        history.close()
+
+    def test_buffer(self) -> None:
+        interferometer_buffer = minipti.gui.model.buffer.Interferometer()
+        for i in range(3 * interferometer_buffer.QUEUE_SIZE):
+            interferometer_buffer.append(TestBuffer._interferometer(i))
+        snapshot = interferometer_buffer.history_snapshot(0, 99)
+        assert snapshot.valid
+        np.testing.assert_array_equal(snapshot.time, np.arange(100))
+        np.testing.assert_array_equal(snapshot.sensitivity, np.tile(snapshot.time, (3, 1)))
+
+
+class TestLoad:
+    def test_sample(self) -> None:
+        sampler = minipti.gui.model.load.Sampler()
+        stop = threading.Event()
+
+        def busy() -> None:
+            while not stop.is_set():
+                with sampler.iteration():
+                    sum(range(10000))
+
+        thread = threading.Thread(target=busy, name="Busy", daemon=True)
+        thread.start()
+        stop.wait(0.5)
+        loads = {load.name: load for load in sampler.sample()}
+        stop.set()
+        thread.join()
+        assert loads["Busy"].iterations > 0 and 0 < loads["Busy"].latency <= loads["Busy"].max_latency
+        if sampler.available:
+            assert loads["Busy"].cpu > 0.1 and "GUI" in loads
+            assert minipti.gui.model.load.summary(list(loads.values())).startswith("CPU")
+        # Every sample starts a new window, the log window is independent of them.
+        sampler.sample()
+        assert "Busy" not in {load.name for load in sampler.sample() if load.iterations}
+        assert {load.name: load for load in sampler.sample_log()}["Busy"].iterations >= loads["Busy"].iterations
+
+
+class TestProfiler:
+    @staticmethod
+    def _profile(output_format: str, destination_folder: str) -> tuple[minipti.gui.model.profiler.Profiler, str]:
+        profiler = minipti.gui.model.profiler.Profiler(interval=0.005, output_format=output_format)
+        profiler.destination_folder = destination_folder
+        stop = threading.Event()
+
+        def busy_loop() -> None:
+            while not stop.is_set():
+                sum(range(10000))
+
+        thread = threading.Thread(target=busy_loop, name="Busy", daemon=True)
+        thread.start()
+        profiler.start()
+        stop.wait(0.3)
+        file_path = profiler.stop()
+        stop.set()
+        thread.join()
+        return profiler, file_path
+
+    def test_collapsed(self, tmp_path) -> None:
+        profiler, file_path = TestProfiler._profile("collapsed", str(tmp_path))
+        assert not profiler.running and profiler.samples > 0
+        with open(file_path) as profile:
+            stacks = [line.rsplit(" ", 1) for line in profile.read().splitlines()]
+        busy = [stack for stack, _ in stacks if stack.startswith("Busy;")]
+        assert busy and any("busy_loop (" in stack for stack in busy)
+        assert sum(int(count) for _, count in stacks) == profiler.samples
+
+    def test_speedscope(self, tmp_path) -> None:
+        _, file_path = TestProfiler._profile("speedscope", str(tmp_path))
+        with open(file_path) as profile:
+            speedscope = json.load(profile)
+        frames = speedscope["shared"]["frames"]
+        profiles = {profile["name"]: profile for profile in speedscope["profiles"]}
+        assert "Profiler" not in profiles
+        busy = profiles["Busy"]
+        assert len(busy["samples"]) == len(busy["weights"])
+        assert any(frames[frame]["name"].endswith("busy_loop") for stack in busy["samples"] for frame in stack)
+
+
+class TestPower:
+    @staticmethod
+    def _bms_data(percentage: int, minutes_left: float = 600,
+                  charging: bool = False) -> minipti.hardware.motherboard.BMSData:
+        return minipti.hardware.motherboard.BMSData(external_dc_power=False, charging=charging,
+                                                    minutes_left=minutes_left, battery_percentage=percentage,
+                                                    battery_temperature=25, battery_current=-1000,
+                                                    battery_voltage=12000, full_charged_capacity=5000,
+                                                    remaining_capacity=50 * percentage)
+
+    def test_profiles(self) -> None:
+        settings = minipti.gui.model.configuration.GUI.power
+        manager = minipti.gui.model.power.Manager(settings)
+        profiles = []
+        for percentage, minutes_left, charging in ((80, 600, False), (49, 600, False), (52, 600, False),
+                                                   (56, 600, False), (80, 100, False), (19, 60, False),
+                                                   (22, 60, False), (22, 60, True)):
+            manager.update(TestPower._bms_data(percentage, minutes_left, charging))
+            profiles.append(manager.profile.name)
+        # A profile is only left with the hysteresis, charging always uses the full profile.
+        assert profiles == ["Full", "Saving", "Saving", "Full", "Saving", "Critical", "Critical", "Full"]
+        assert minipti.algorithm._utilities.CSV_ROWS.batch_rows == settings.full.csv_batch_rows
+
+    def test_row_buffer(self, tmp_path) -> None:
+        rows = minipti.algorithm._utilities.RowBuffer(batch_rows=3)
+        file_path = tmp_path / "rows.csv"
+        for i in range(4):
+            rows.append(str(file_path), "2024-01-01", [i, i / 2])
+        assert file_path.read_text().splitlines() == [f"2024-01-01,{i},{i / 2}" for i in range(3)]
+        rows.flush()
+        assert len(file_path.read_text().splitlines()) == 4
+
+    def test_row_buffer_failed_write(self, tmp_path) -> None:
+        rows = minipti.algorithm._utilities.RowBuffer(batch_rows=2)
+        file_path = tmp_path / "missing" / "rows.csv"
+        for i in range(3):
+            rows.append(str(file_path), "2024-01-01", [i])
+        assert not file_path.exists()
+        file_path.parent.mkdir()
+        rows.append(str(file_path), "2024-01-01", [3])
+        rows.append(str(file_path), "2024-01-01", [4])
+        rows.flush()
+        assert file_path.read_text().splitlines() == [f"2024-01-01,{i}" for i in range(5)]
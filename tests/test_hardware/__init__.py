@@ -1,2 +1,3 @@
 from . import test_laser
 from . import test_motherboard
+from . import test_tec
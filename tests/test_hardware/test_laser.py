@@ -1,5 +1,7 @@
 import os
 import pathlib
+import threading
+import time
 
 import pytest
 
@@ -32,3 +34,76 @@ class TestHighPowerLaserConfig(DriverTests):
     def test_no_config(self):
         self.driver.high_power_laser.config_path = "tmp.txt"
         assert not self.driver.high_power_laser.load_configuration()
+
+
+class TestPriority:
+    ACK_DELAY = 0.1  # s
+    MAX_STOP_LATENCY = 0.05  # s
+
+    def test_stop_latency(self) -> None:
+        driver = minipti.hardware.laser.Driver()
+        written: list[tuple[str, float]] = []
+
+        def transfer() -> None:
+            command = driver.last_written_message[:-1]
+            written.append((command, time.perf_counter()))
+            # The configuration is acknowledged slowly, the stop immediately.
+            threading.Timer(0 if command == "SHE0000" else TestPriority.ACK_DELAY, driver._encode,
+                            args=(command,)).start()
+
+        driver._transfer = transfer
+        driver.connected.set()
+        try:
+            transactions = [driver.high_power_laser.apply_configuration() for _ in range(3)]
+            threading.Thread(target=driver._write, daemon=True).start()
+            time.sleep(TestPriority.ACK_DELAY / 3)  # The first command of the burst is outstanding
+            start = time.perf_counter()
+            driver.high_power_laser.enabled = False
+            for transaction in transactions[1:]:
+                assert transaction.wait(timeout=len(transaction.commands) * 2 * TestPriority.ACK_DELAY)
+            stop_time = next(written_time for command, written_time in written if command == "SHE0000")
+            assert stop_time - start < TestPriority.MAX_STOP_LATENCY
+            assert not transactions[0].wait(timeout=0)  # Pre-empted and rolled back
+            time.sleep(TestPriority.ACK_DELAY)
+            assert not driver._preempted  # The late acknowledgement was discarded
+        finally:
+            driver.connected.clear()
+
+    def test_enable_before_stop(self) -> None:
+        driver = minipti.hardware.laser.Driver()
+        written: list[str] = []
+
+        def transfer() -> None:
+            command = driver.last_written_message[:-1]
+            written.append(command)
+            threading.Timer(TestPriority.ACK_DELAY, driver._encode, args=(command,)).start()
+
+        driver._transfer = transfer
+        driver.connected.set()
+        try:
+            driver.high_power_laser.apply_configuration()
+            driver.high_power_laser.enabled = True
+            with driver.transaction() as enabling:
+                driver.write("SC30791")
+                driver.write("SHE0001")
+            threading.Thread(target=driver._write, daemon=True).start()
+            time.sleep(TestPriority.ACK_DELAY / 3)
+            driver.high_power_laser.enabled = False
+            assert not enabling.wait(timeout=0)  # Discarded without being written
+            time.sleep(3 * TestPriority.ACK_DELAY)
+            assert "SHE0001" not in written
+            assert written[-1] == "SHE0000"
+            assert not driver.write_buffer_size
+        finally:
+            driver.connected.clear()
+
+    def test_acknowledgement_before_preemption(self) -> None:
+        driver = minipti.hardware.laser.Driver()
+        driver._transfer = lambda: None
+        driver._send("SC30791")
+        driver._enqueue("SHE0000", priority=True)
+        driver._check_ack("SC30791")  # Arrives before the write thread handles the pre-emption
+        assert driver._wait_for_acknowledgement()
+        assert not driver._preempted
+        driver._send("SHE0000")
+        assert not driver._ready_write.is_set()  # Waits for the acknowledgement of the stop
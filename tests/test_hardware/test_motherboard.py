@@ -3,6 +3,8 @@ Unit tests for the hardware.Motherboard API of the MiniPTI.
 """
 import itertools
 import os
+import threading
+import time
 
 import numpy as np
 import pytest
@@ -246,3 +248,58 @@ class TestSynchronizeWithRef(DriverTests):
         ref = self.driver.daq.encoded_buffer.ref_signal
         ref_period = self.driver.daq.configuration.ref_period // 2
         assert not sum(itertools.islice(ref, ref_period))
+
+
+class TestResetDuringEncoding(DriverTests):
+    def test_stale_package_discarded(self, monkeypatch) -> None:
+        resets = []
+
+        def encode(data: str) -> None:
+            # The GUI thread resets before a new run while the processing thread still encodes.
+            reset = threading.Thread(target=self.driver.reset)
+            reset.start()
+            resets.append(reset)
+            time.sleep(0.05)
+
+        monkeypatch.setattr(self.driver, "_encode", encode)
+        self.transmission("S00000\nDstale")
+        for reset in resets:
+            reset.join()
+        assert resets and not self.driver.buffer_size
+
+
+class TestAveragePeriodChange(DriverTests):
+    emulator = minipti.hardware.emulator.Motherboard(
+        minipti.hardware.emulator.Interferometer(
+            minipti.algorithm.interferometry.CharacteristicParameter(
+                amplitudes=np.ones(3), offsets=np.full(3, 1.5),
+                output_phases=np.array([0, 2 * np.pi / 3, 4 * np.pi / 3])
+            )
+        )
+    )
+
+    def _packages(self) -> list[int]:
+        packages = []
+        while not self.driver.daq.data[minipti.hardware.motherboard.PackageIndex.AC].empty():
+            _, ac, _ = (package.get() for package in self.driver.daq.data)
+            packages.append(ac.shape[1])
+        return packages
+
+    def test_no_samples_lost(self) -> None:
+        number_of_samples = self.driver.daq.number_of_samples
+        self.driver.daq.synchronize = True
+        self.driver.daq.number_of_samples = 800
+        self.transmission(self.emulator.frames(1600))
+        packages = self._packages()
+        assert packages and set(packages) == {800}
+        accounted = sum(packages) + self.driver.daq.samples_buffer_size
+        self.driver.daq.number_of_samples = 400
+        for _ in range(4):
+            self.transmission(self.emulator.frames(400))
+            new_packages = self._packages()
+            assert set(new_packages) <= {400}
+            packages += new_packages
+            accounted += -(-400 // 128) * 128
+            assert sum(packages) + self.driver.daq.samples_buffer_size == accounted
+        assert 400 in packages
+        self.driver.daq.number_of_samples = number_of_samples
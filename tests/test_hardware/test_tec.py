@@ -0,0 +1,132 @@
+"""
+Unit tests for the hardware.Tec API of the MiniPTI.
+"""
+import pytest
+
+import minipti
+
+
+class TestCommands:
+    def test_template_format(self) -> None:
+        command = minipti.hardware.protocolls.ASCIIMultimap(key="SetPID_KP", index=1, value=2.5)
+        assert str(command) == "SetPID_KP:[1,2.5]"
+        command.value = 3
+        assert str(command) == "SetPID_KP:[1,3]"
+        assert minipti.hardware.protocolls.multimap_template("SetPID_KP", 1) is \
+               minipti.hardware.protocolls.multimap_template("SetPID_KP", 1)
+
+    def test_parse_stream(self) -> None:
+        command = minipti.hardware.protocolls.ASCIIMultimap("SetT_InK:[0,296.15]\n")
+        assert command.key == "SetT_InK"
+        assert command.index == 0
+        assert command.value == 296.15
+
+    def test_invalid_key(self) -> None:
+        with pytest.raises(ValueError):
+            minipti.hardware.protocolls.ASCIIMultimap(key="Invalid", value=0)
+
+
+class TestTransaction:
+    driver = minipti.hardware.tec.Driver()
+
+    @pytest.fixture(autouse=True)
+    def setup(self) -> None:
+        TestTransaction.driver.connected.set()
+        yield
+        TestTransaction.driver.connected.clear()
+
+    def _answer(self, answer) -> None:
+        def transfer() -> None:
+            TestTransaction.driver._encode(answer(TestTransaction.driver.last_written_message[:-1]))
+
+        TestTransaction.driver._transfer = transfer
+
+    def test_acknowledged(self) -> None:
+        self._answer(lambda written: written)
+        tec = TestTransaction.driver.tec[0]
+        tec.configuration.pid.proportional_value = 2
+        transaction = tec.apply_configuration()
+        assert len(transaction.commands) == 6
+        TestTransaction.driver._write_transaction(TestTransaction.driver._write_buffer.get(block=False))
+        assert transaction.wait(timeout=0)
+        assert tec.configuration.pid.proportional_value == 2
+
+    def test_rollback(self) -> None:
+        self._answer(lambda written: written if not written.startswith("SetPID_KP") else "SetPID_KP:PARAMERROR")
+        tec = TestTransaction.driver.tec[1]
+        old_value = tec.configuration.pid.proportional_value
+        old_command = tec.commands.set_p_gain.value
+        # The GUI changes the configuration before it is applied.
+        tec.configuration.pid.proportional_value = old_value + 1
+        transaction = tec.apply_configuration()
+        completed = []
+        transaction.add_done_callback(completed.append)
+        TestTransaction.driver._write_transaction(TestTransaction.driver._write_buffer.get(block=False))
+        assert not transaction.wait(timeout=0)
+        assert completed == [transaction]
+        assert tec.configuration.pid.proportional_value == old_value
+        assert tec.commands.set_p_gain.value == old_command
+
+    def test_rollback_to_acknowledged(self) -> None:
+        tec = TestTransaction.driver.tec[1]
+        old_value = tec.configuration.pid.proportional_value
+        self._answer(lambda written: written)
+        tec.configuration.pid.proportional_value = old_value + 1
+        tec.apply_configuration()
+        TestTransaction.driver._write_transaction(TestTransaction.driver._write_buffer.get(block=False))
+        self._answer(lambda written: written if not written.startswith("SetPID_KP") else "SetPID_KP:PARAMERROR")
+        tec.configuration.pid.proportional_value = old_value + 2
+        transaction = tec.apply_configuration()
+        TestTransaction.driver._write_transaction(TestTransaction.driver._write_buffer.get(block=False))
+        assert not transaction.wait(timeout=0)
+        assert tec.configuration.pid.proportional_value == old_value + 1
+        tec.load_configuration()
+
+    def test_not_connected(self) -> None:
+        TestTransaction.driver.connected.clear()
+        transaction = TestTransaction.driver.tec[0].apply_configuration()
+        assert transaction.done and not transaction.succeeded and transaction.discarded
+        completed = []
+        transaction.add_done_callback(completed.append)
+        assert completed == [transaction]
+        assert TestTransaction.driver.write_buffer_size == 0
+
+
+class TestCommandLatency:
+    driver = minipti.hardware.tec.Driver()
+
+    @pytest.fixture(autouse=True)
+    def setup(self) -> None:
+        TestCommandLatency.driver.connected.set()
+        TestCommandLatency.driver.command_latency.clear()
+        yield
+        TestCommandLatency.driver.connected.clear()
+
+    def test_key(self) -> None:
+        assert minipti.hardware.serial_device.CommandLatency.key("SetPID_KP:[0,1]") == "SetPID_KP"
+        assert minipti.hardware.serial_device.CommandLatency.key("SHD0001") == "SHD"
+
+    def test_round_trips(self) -> None:
+        unanswered = []
+
+        def transfer() -> None:
+            written = TestCommandLatency.driver.last_written_message[:-1]
+            if written.startswith(tuple(unanswered)):
+                return
+            TestCommandLatency.driver._encode(written if not written.startswith("SetPID_KI")
+                                              else "SetPID_KI:PARAMERROR")
+
+        TestCommandLatency.driver._transfer = transfer
+        for unanswered_key in (None, "SetPID_KD"):
+            if unanswered_key is not None:
+                unanswered.append(unanswered_key)
+            transaction = TestCommandLatency.driver.tec[0].apply_configuration()
+            TestCommandLatency.driver._ready_write.clear()  # As done by the write thread
+            TestCommandLatency.driver._write_transaction(TestCommandLatency.driver._write_buffer.get(block=False))
+            assert not transaction.wait(timeout=0)
+        summary = TestCommandLatency.driver.command_latency.summary()
+        assert summary.loc["SetPID_KD", ["Acknowledged", "Timeouts"]].tolist() == [1, 1]
+        assert summary.loc["SetPID_KP", "Acknowledged"] == 1 and summary.loc["SetPID_KI", "Failed"] == 1
+        assert summary.loc["SetPID_KP", "P95 [ms]"] < 500
+        histograms = TestCommandLatency.driver.command_latency.histograms()
+        assert histograms["SetPID_KD"].sum() == 1 and histograms["SetPID_KI"].sum() == 1